@@ -28,7 +28,7 @@ class CGI
 	void executeCGIChild(const std::string &script_path, int pipe_in[2],
 		int pipe_out[2]);
 	std::string handleCGIParent(pid_t pid, int pipe_in[2], int pipe_out[2]);
-	std::string parseCGIOutput(const std::string &raw_output);
+	void parseCGIOutput(std::string &output);
 	std::string generateErrorResponse(int code, const std::string &message);
 	std::string getDirectoryPath(const std::string &file_path);
 	std::string toUpperSnakeCase(const std::string &str);
@@ -0,0 +1,43 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   ClientConnection.hpp                               :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: ewiese-m <ewiese-m@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/08/22 14:33:09 by ewiese-m          #+#    #+#             */
+/*   Updated: 2025/08/22 14:33:09 by ewiese-m         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#pragma once
+
+#include "DirectoryListing.hpp"
+#include "HttpRequest.hpp"
+#include "OutputQueue.hpp"
+#include "ServerConfig.hpp"
+#include <string>
+
+struct ClientConnection
+{
+	int fd;
+	std::string buffer;
+	HttpRequest request;
+	bool keep_alive;
+	int listener;
+	const ServerConfig *server;
+	std::string client_ip;
+	OutputQueue output;
+	std::string header_buffer;
+	DirectoryListing listing;
+	bool close_after_write;
+	bool input_pending;
+	bool server_resolved;
+	static const size_t RETAIN_CAPACITY = 64 * 1024;
+	ClientConnection();
+	void reset();
+
+  private:
+	ClientConnection(const ClientConnection &);
+	ClientConnection &operator=(const ClientConnection &);
+};
@@ -0,0 +1,36 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   Clock.hpp                                          :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: ewiese-m <ewiese-m@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/08/27 14:02:37 by ewiese-m          #+#    #+#             */
+/*   Updated: 2025/08/27 14:02:37 by ewiese-m         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#pragma once
+
+#include <ctime>
+#include <string>
+
+/*
+** Process-wide coarse clock. The event loop calls update() once per
+** iteration; everything else reads now() instead of calling time(), and
+** responses append the preformatted Date header line, which is rebuilt only
+** when the second changes.
+*/
+class Clock
+{
+  public:
+	static void update();
+	static time_t now();
+	static const std::string &dateHeader();
+
+  private:
+	static time_t now_;
+	static time_t formatted_;
+	static std::string date_header_;
+	Clock();
+};
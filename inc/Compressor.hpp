@@ -0,0 +1,47 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   Compressor.hpp                                     :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: ewiese-m <ewiese-m@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/08/27 09:31:52 by ewiese-m          #+#    #+#             */
+/*   Updated: 2025/08/27 09:31:52 by ewiese-m         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#pragma once
+
+#include <string>
+#include <zlib.h>
+
+/*
+** Streaming zlib compressor for response bodies. Input is fed in pieces with
+** update() and closed with finish(); output is produced through a fixed-size
+** stack buffer, and the deflate window is shrunk for small bodies, so memory
+** stays bounded regardless of how the body is delivered.
+*/
+class Compressor
+{
+  public:
+	enum Format
+	{
+		FORMAT_GZIP,
+		FORMAT_DEFLATE
+	};
+	Compressor(Format format, int level, size_t size_hint);
+	~Compressor();
+	bool ok() const;
+	bool update(const char *data, size_t length, std::string &out);
+	bool finish(std::string &out);
+	static const char *encodingName(Format format);
+	static bool compress(Format format, int level, const char *data,
+		size_t length, std::string &out);
+
+  private:
+	z_stream stream_;
+	bool ok_;
+	bool run(const char *data, size_t length, int flush, std::string &out);
+	Compressor(const Compressor &);
+	Compressor &operator=(const Compressor &);
+};
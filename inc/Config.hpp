@@ -1,6 +1,8 @@
 #pragma once
 
+#include "MimeTypes.hpp"
 #include "ServerConfig.hpp"
+#include <ctime>
 #include <string>
 #include <vector>
 
@@ -10,6 +12,17 @@ class Config
 	Config(const std::string &file_path);
 	~Config();
 	const std::vector<ServerConfig> &getServers() const;
+	const std::string &getEventBackend() const;
+	bool isEdgeTriggered() const;
+	int getWorkerProcesses() const;
+	bool getWorkerCpuAffinity() const;
+	size_t getOpenFileCacheMax() const;
+	time_t getOpenFileCacheInactive() const;
+	time_t getOpenFileCacheValid() const;
+	bool getOpenFileCacheErrors() const;
+	size_t getStaticCacheMax() const;
+	size_t getStaticCacheEntryMax() const;
+	const MimeTypes &getMimeTypes() const;
 	const ServerConfig &findServerConfigForRequest(const std::string &host,
 		int port) const;
 	void parse(const std::string &file_path);
@@ -17,10 +30,25 @@ class Config
 
   private:
 	std::vector<ServerConfig> _servers;
+	std::string _event_backend;
+	bool _edge_triggered;
+	int _worker_processes;
+	bool _worker_cpu_affinity;
+	size_t _open_file_cache_max;
+	time_t _open_file_cache_inactive;
+	time_t _open_file_cache_valid;
+	bool _open_file_cache_errors;
+	size_t _static_cache_max;
+	size_t _static_cache_entry_max;
+	MimeTypes _mime_types;
+	std::string _config_dir;
 	Config();
 	Config(const Config &other);
 	Config &operator=(const Config &other);
+	void parseGlobalDirective(const std::string &directive,
+		const std::string &value);
 	void parseServerBlock(std::istream &file, bool *closed);
+	void parseTypesBlock(std::istream &file);
 	void parseLocationBlock(std::istream &file, ServerConfig &server,
 		bool *closed);
 	void parseDirective(ServerConfig &server, LocationConfig &location,
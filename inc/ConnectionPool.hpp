@@ -0,0 +1,46 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   ConnectionPool.hpp                                 :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: ewiese-m <ewiese-m@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/08/22 14:33:09 by ewiese-m          #+#    #+#             */
+/*   Updated: 2025/08/22 14:33:09 by ewiese-m         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#pragma once
+
+#include "ClientConnection.hpp"
+#include <vector>
+
+/*
+** Slab of ClientConnection objects owned by WebServer. Lookups go through an
+** fd-indexed table of slot numbers; released slots go to a free list and are
+** handed out again on the next accept, so connections keep their buffers'
+** capacity (up to ClientConnection::RETAIN_CAPACITY) and a steady-state
+** accept/close cycle does not allocate. Slots are allocated once and never
+** move.
+*/
+
+class ConnectionPool
+{
+  public:
+	ConnectionPool();
+	~ConnectionPool();
+	void reserve(size_t connections, size_t max_fd);
+	ClientConnection *acquire(int fd);
+	ClientConnection *find(int fd);
+	void release(int fd);
+	size_t size() const;
+	int maxFd() const;
+
+  private:
+	std::vector<ClientConnection *> slots_;
+	std::vector<int> index_;
+	std::vector<int> free_;
+	size_t active_;
+	ConnectionPool(const ConnectionPool &);
+	ConnectionPool &operator=(const ConnectionPool &);
+};
@@ -0,0 +1,84 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   ContentCache.hpp                                   :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: ewiese-m <ewiese-m@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/08/25 18:44:09 by ewiese-m          #+#    #+#             */
+/*   Updated: 2025/08/25 18:44:09 by ewiese-m         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#pragma once
+
+#include "HttpResponse.hpp"
+#include "OpenFileCache.hpp"
+#include "SharedBuffer.hpp"
+#include <list>
+#include <map>
+#include <string>
+
+/*
+** A small static file held in memory: the body plus the response header,
+** serialized once for keep-alive and once for close. All three are shared
+** buffers, so a hit is queued without copying and goes out in one writev
+** together with whatever else is pending on the connection. The header block
+** stops short of the blank line that ends it, so the caller can append
+** per-request headers such as Expires.
+**
+** The same file can be cached under several variants (e.g. a .gz sibling
+** served with and without Content-Encoding) when their headers differ.
+*/
+struct CachedContent
+{
+	std::string key;
+	SharedBuffer *header[2];
+	SharedBuffer *body;
+	ino_t inode;
+	off_t size;
+	time_t mtime;
+	size_t cost;
+	std::list<CachedContent *>::iterator lru;
+};
+
+/*
+** Bounded LRU cache of small static files. Entries are invalidated through
+** inotify: the directory of every cached file is watched, and any change to
+** a name in it drops the matching entry. Without inotify the cache stays
+** disabled, since nothing would tell it a file has changed.
+*/
+class ContentCache
+{
+  public:
+	ContentCache();
+	~ContentCache();
+	void configure(size_t max_total, size_t max_entry);
+	int start();
+	bool enabled() const;
+	const CachedContent *find(const std::string &path,
+		const std::string &variant, const OpenFile &file);
+	const CachedContent *insert(const std::string &path,
+		const std::string &variant, const OpenFile &file, HttpResponse &header);
+	void handleEvents(OpenFileCache &files);
+	void invalidate(const std::string &path);
+
+  private:
+	typedef std::map<std::string, CachedContent *> Index;
+	Index index_;
+	std::list<CachedContent *> lru_;
+	std::map<int, std::string> watches_;
+	std::map<std::string, int> watched_dirs_;
+	size_t max_total_;
+	size_t max_entry_;
+	size_t total_;
+	int notify_fd_;
+	static std::string headerBlock(const HttpResponse &header);
+	static std::string key(const std::string &path, const std::string &variant);
+	bool watch(const std::string &dir);
+	void dropDirectory(int wd);
+	void drop(Index::iterator it);
+	void clear();
+	ContentCache(const ContentCache &);
+	ContentCache &operator=(const ContentCache &);
+};
@@ -0,0 +1,167 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   DirectoryListing.hpp                               :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: ewiese-m <ewiese-m@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/08/31 11:06:40 by ewiese-m          #+#    #+#             */
+/*   Updated: 2025/08/31 11:06:40 by ewiese-m         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#pragma once
+
+#include "Compressor.hpp"
+#include "OutputQueue.hpp"
+#include "StringRef.hpp"
+#include <ctime>
+#include <list>
+#include <map>
+#include <string>
+#include <sys/types.h>
+#include <utility>
+#include <vector>
+
+/*
+** Sorted contents of one directory, read in a single readdir() pass. Names
+** are stored back to back in one arena and entries refer to them by offset.
+** Each entry is stat'ed once with fstatat() relative to the directory fd, so
+** no path is built for it; d_type tells which entries are symlinks and need
+** to be followed. Listings small enough to be sent in one piece also keep
+** their HTML rows rendered.
+**
+** The validators of a listing come from what was read, not from the
+** directory inode: digest() folds every name, type, size and mtime, and
+** mtime() is the latest of the directory's and its entries' mtimes, so
+** a file that is rewritten in place changes both.
+**
+** Snapshots are reference counted: a connection streaming a listing keeps
+** its snapshot alive after the cache has dropped it.
+*/
+class DirectorySnapshot
+{
+  public:
+	struct Entry
+	{
+		size_t name;
+		size_t length;
+		bool is_dir;
+		off_t size;
+		time_t mtime;
+	};
+	struct Stamp
+	{
+		time_t time;
+		size_t length;
+		char text[40];
+	};
+	static const size_t RENDER_LIMIT = 2048;
+	static DirectorySnapshot *scan(const std::string &path);
+	DirectorySnapshot *retain();
+	void release();
+	size_t size() const;
+	size_t cost() const;
+	unsigned int digest() const;
+	time_t mtime() const;
+	const std::string &htmlRows() const;
+	void render(std::string &out, size_t first, size_t last, bool json,
+		size_t start) const;
+
+  private:
+	std::string names_;
+	std::vector<Entry> entries_;
+	std::string html_rows_;
+	unsigned int digest_;
+	time_t mtime_;
+	int refs_;
+	void renderHtml(std::string &out, const Entry &entry, Stamp &stamp) const;
+	void renderJson(std::string &out, const Entry &entry, Stamp &stamp) const;
+	DirectorySnapshot();
+	~DirectorySnapshot();
+	DirectorySnapshot(const DirectorySnapshot &);
+	DirectorySnapshot &operator=(const DirectorySnapshot &);
+};
+
+/*
+** Directory snapshots for autoindex, keyed by device and inode. Every lookup
+** stat()s the directory itself rather than trusting the open file cache, so
+** an added or removed name shows up at once. A snapshot is reused while the
+** directory's mtime is unchanged and it is younger than the
+** open_file_cache_valid window, which bounds how stale the size and mtime of
+** entries can get. A snapshot taken in the same second as the last
+** change to the directory is never trusted, since a second change within
+** that second would not move the mtime. Least recently used snapshots are
+** dropped once their total size passes MAX_TOTAL.
+*/
+class DirectoryCache
+{
+  public:
+	DirectoryCache();
+	~DirectoryCache();
+	void configure(time_t valid);
+	DirectorySnapshot *get(const std::string &path, time_t now);
+
+  private:
+	typedef std::pair<dev_t, ino_t> Key;
+	struct Slot
+	{
+		DirectorySnapshot *snapshot;
+		time_t mtime;
+		time_t scanned;
+		size_t cost;
+		std::list<Key>::iterator lru;
+	};
+	typedef std::map<Key, Slot> Index;
+	static const size_t MAX_TOTAL = 32 * 1024 * 1024;
+	Index index_;
+	std::list<Key> lru_;
+	size_t total_;
+	time_t valid_;
+	void drop(Index::iterator it);
+	DirectoryCache(const DirectoryCache &);
+	DirectoryCache &operator=(const DirectoryCache &);
+};
+
+/*
+** Page framing for autoindex responses, and the state of a listing being
+** streamed to one connection. A listing longer than STREAM_LIMIT entries is
+** never built in memory: the header goes out first, and pump() renders the
+** next BATCH entries each time the output queue drains. The body is sent in
+** HTTP/1.1 chunks, or for HTTP/1.0 clients ends when the connection closes.
+** With a compressor each batch is deflated as it is rendered, so only the
+** zlib state is held across batches.
+*/
+class DirectoryListing
+{
+  public:
+	static const size_t STREAM_LIMIT = DirectorySnapshot::RENDER_LIMIT;
+	DirectoryListing();
+	~DirectoryListing();
+	void start(DirectorySnapshot *dir, size_t first, size_t last, bool json,
+		bool chunked, Compressor *compressor, std::string &head,
+		const std::string &tail);
+	bool active() const;
+	bool pump(OutputQueue &output);
+	void clear();
+	static void parsePage(const StringRef &query, size_t total, size_t *first,
+		size_t *last, size_t *limit);
+	static void renderHead(std::string &out, const std::string &uri,
+		bool json);
+	static void renderTail(std::string &out, bool json, size_t first,
+		size_t limit, size_t total);
+
+  private:
+	static const size_t BATCH = 256;
+	DirectorySnapshot *dir_;
+	size_t start_;
+	size_t next_;
+	size_t end_;
+	bool json_;
+	bool chunked_;
+	Compressor *compressor_;
+	std::string head_;
+	std::string tail_;
+	DirectoryListing(const DirectoryListing &);
+	DirectoryListing &operator=(const DirectoryListing &);
+};
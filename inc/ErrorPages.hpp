@@ -0,0 +1,60 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   ErrorPages.hpp                                     :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: ewiese-m <ewiese-m@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/08/30 10:41:12 by ewiese-m          #+#    #+#             */
+/*   Updated: 2025/08/30 10:41:12 by ewiese-m         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#pragma once
+
+#include "HttpResponse.hpp"
+#include "ServerConfig.hpp"
+#include "SharedBuffer.hpp"
+#include <map>
+#include <vector>
+
+/*
+** A complete error response held in shared buffers: the header serialized
+** once for close and once for keep-alive, stopping short of the Date line
+** and the blank line, plus the body. custom marks a page read from an
+** error_page file rather than generated from the reason phrase.
+*/
+struct ErrorPage
+{
+	SharedBuffer *header[2];
+	SharedBuffer *body;
+	bool custom;
+};
+
+/*
+** Error responses prepared when the configuration is loaded: one built-in
+** page per error status in the status table, shared by every server, and
+** one page per error_page directive of each server, read from disk once.
+** A page that cannot be read falls back to the built-in one. build() may be
+** called again to pick up a new configuration; responses already queued
+** keep the old buffers alive until they are sent.
+*/
+class ErrorPages
+{
+  public:
+	ErrorPages();
+	~ErrorPages();
+	void build(const std::vector<ServerConfig> &servers);
+	const ErrorPage *find(size_t server, int code) const;
+
+  private:
+	typedef std::map<int, ErrorPage> PageMap;
+	std::vector<ErrorPage> builtin_;
+	std::vector<PageMap> custom_;
+	void clear();
+	static ErrorPage make(int code, const std::string &body, bool custom);
+	static void drop(ErrorPage &page);
+	static std::string headerBlock(const HttpResponse &header);
+	ErrorPages(const ErrorPages &);
+	ErrorPages &operator=(const ErrorPages &);
+};
@@ -1,32 +1,114 @@
 #pragma once
 
-#include <map>
+#include "StringRef.hpp"
 #include <string>
+#include <vector>
+
+/*
+** Request whose fields are offset/length slices into the connection buffer
+** it was parsed from. Parsing a request with up to INLINE_HEADERS headers
+** does not allocate; the getters return StringRefs that stay valid until the
+** buffer is modified.
+*/
 
 class HttpRequest
 {
   public:
+	enum ParseStatus
+	{
+		PARSE_INCOMPLETE,
+		PARSE_COMPLETE,
+		PARSE_ERROR
+	};
+	enum Method
+	{
+		METHOD_GET,
+		METHOD_POST,
+		METHOD_DELETE,
+		METHOD_PUT,
+		METHOD_HEAD,
+		METHOD_OPTIONS,
+		METHOD_COUNT
+	};
+	enum Version
+	{
+		HTTP_1_0,
+		HTTP_1_1
+	};
+	enum HeaderId
+	{
+		HEADER_HOST,
+		HEADER_CONNECTION,
+		HEADER_CONTENT_LENGTH,
+		HEADER_CONTENT_TYPE,
+		HEADER_TRANSFER_ENCODING,
+		HEADER_ACCEPT_ENCODING,
+		HEADER_RANGE,
+		HEADER_IF_RANGE,
+		HEADER_IF_NONE_MATCH,
+		HEADER_IF_MODIFIED_SINCE,
+		HEADER_KNOWN_COUNT
+	};
 	HttpRequest();
-	bool parse(const std::string &data);
-	const std::string &getMethod() const;
-	const std::string &getUri() const;
-	const std::string &getHttpVersion() const;
-	const std::string &getBody() const;
-	std::string getHeader(const std::string &name) const;
-	const std::map<std::string, std::string> &getHeaders() const;
+	ParseStatus parse(const std::string &data);
+	void reset();
+	bool headersComplete() const;
+	int getErrorStatus() const;
+	size_t getHeaderBytes() const;
+	size_t getContentLength() const;
+	size_t getLength() const;
+	StringRef getMethod() const;
+	Method getMethodId() const;
+	StringRef getUri() const;
+	StringRef getHttpVersion() const;
+	Version getVersion() const;
+	StringRef getBody() const;
+	StringRef getHeader(HeaderId id) const;
+	StringRef getHeader(const char *name) const;
+	size_t getHeaderCount() const;
+	StringRef getHeaderName(size_t index) const;
+	StringRef getHeaderValue(size_t index) const;
+	static Method methodFromName(const StringRef &name);
+	static const char *methodName(Method method);
 
   private:
-	std::string method_;
-	std::string uri_;
-	std::string http_version_;
-	std::map<std::string, std::string> headers_;
-	std::string body_;
-	bool is_valid_;
+	enum State
+	{
+		STATE_REQUEST_LINE,
+		STATE_HEADERS,
+		STATE_BODY,
+		STATE_COMPLETE,
+		STATE_ERROR
+	};
+	struct Slice
+	{
+		size_t offset;
+		size_t length;
+	};
+	struct HeaderField
+	{
+		Slice name;
+		Slice value;
+	};
+	static const size_t INLINE_HEADERS = 24;
+	const std::string *data_;
+	Method method_;
+	Version version_;
+	Slice uri_;
+	Slice http_version_;
+	Slice body_;
+	HeaderField headers_[INLINE_HEADERS];
+	std::vector<HeaderField> extra_headers_;
+	size_t header_count_;
+	int known_[HEADER_KNOWN_COUNT];
+	State state_;
+	size_t line_start_;
+	size_t scan_pos_;
+	size_t header_end_;
 	size_t body_length_;
-	void clear();
-	bool parseRequestLine(const std::string &line);
-	bool parseHeaders(const std::string &headers);
-	void parseBody(const std::string &body);
-	static std::string trim(const std::string &str);
-	static std::string toLowerCase(const std::string &str);
+	int error_status_;
+	bool parseRequestLine(size_t start, size_t end);
+	bool parseHeaderLine(size_t start, size_t end);
+	const HeaderField &header(size_t index) const;
+	StringRef ref(const Slice &slice) const;
 };
@@ -1,29 +1,43 @@
 #pragma once
 
-#include <map>
+#include "StringRef.hpp"
 #include <string>
+#include <utility>
+#include <vector>
 
+/*
+** Header names are stored as given; callers use lowercase literals, so no
+** per-header case folding happens at runtime. The serializer appends into a
+** caller-owned buffer and leaves the body alone, so the body can be queued
+** as its own iovec instead of being copied behind the header.
+*/
 class HttpResponse
 {
   public:
+	typedef std::pair<std::string, std::string> Header;
 	HttpResponse();
 	std::string serialize() const;
+	void serializeHeader(std::string &out, bool with_date = true) const;
 	void setError(int code, const std::string &message);
 	void addHeader(const std::string &key, const std::string &value);
+	void removeHeader(const std::string &key);
+	const std::string *getHeader(const std::string &key) const;
 	int getStatusCode() const;
 	const std::string &getBody() const;
 	const std::string &getConnectionType() const;
-	const std::map<std::string, std::string> &getHeaders() const;
+	const std::vector<Header> &getHeaders() const;
 	void setStatusCode(int code);
 	void setBody(const std::string &content);
+	void swapBody(std::string &other);
 	void setConnectionType(const std::string &type);
+	void setCloseDelimited(bool close_delimited);
+	static StringRef reasonPhrase(int code);
 
   private:
 	int status_code_;
 	std::string connection_type_;
-	std::map<std::string, std::string> headers_;
+	std::vector<Header> headers_;
 	std::string body_;
-	static std::map<int, std::string> initStatusCodes();
-	static const std::map<int, std::string> status_messages_;
-	static std::string toLowerCase(const std::string &str);
+	bool close_delimited_;
+	static void appendStatusLine(std::string &out, int code);
 };
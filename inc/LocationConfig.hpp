@@ -1,5 +1,6 @@
 #pragma once
 
+#include <ctime>
 #include <string>
 #include <vector>
 
@@ -10,13 +11,30 @@ class LocationConfig
 	~LocationConfig();
 	LocationConfig(const LocationConfig &other);
 	LocationConfig &operator=(const LocationConfig &other);
+	enum ExpiresMode
+	{
+		EXPIRES_OFF,
+		EXPIRES_RELATIVE,
+		EXPIRES_FIXED
+	};
 	std::string _path;
 	std::string _root;
 	std::vector<std::string> _allowed_methods;
+	unsigned int _allowed_mask;
 	std::string _index_file;
 	bool _directory_listing;
 	std::string _cgi_path;
 	std::string _cgi_extension;
 	std::string _upload_path;
 	std::string _redirect;
+	bool _static_compressed;
+	bool _compress;
+	std::vector<std::string> _compress_types;
+	size_t _compress_min_length;
+	int _compress_level;
+	ExpiresMode _expires_mode;
+	time_t _expires;
+	std::string _cache_control;
+	std::string _expires_header;
+	std::string _cache_control_header;
 };
@@ -0,0 +1,56 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   LocationRouter.hpp                                 :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: ewiese-m <ewiese-m@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/08/28 10:26:13 by ewiese-m          #+#    #+#             */
+/*   Updated: 2025/08/28 10:26:13 by ewiese-m         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#pragma once
+
+#include "LocationConfig.hpp"
+#include "StringRef.hpp"
+#include <string>
+#include <utility>
+#include <vector>
+
+/*
+** Location lookup compiled once per server at config load. Prefix locations
+** ("/", "/upload", ...) go into a radix trie walked once along the request
+** path; extension locations (".php", ".py") go into a sorted table matched
+** exactly against the extension of the path's last segment.
+**
+** Precedence, first hit wins:
+**   1. a prefix location equal to the whole path;
+**   2. an extension location equal to the path's extension;
+**   3. the longest prefix location ending on a segment boundary;
+**   4. the first location of the server.
+** A path is everything before '?'. Locations are stored as indices, so the
+** router stays valid when its ServerConfig is copied.
+*/
+class LocationRouter
+{
+  public:
+	LocationRouter();
+	void compile(const std::vector<LocationConfig> &locations);
+	int find(const StringRef &uri) const;
+
+  private:
+	struct Node
+	{
+		std::string label;
+		int location;
+		std::string keys;
+		std::vector<int> children;
+	};
+	typedef std::pair<std::string, int> Extension;
+	std::vector<Node> nodes_;
+	std::vector<Extension> extensions_;
+	void insert(const std::string &path, int location);
+	int newNode(const std::string &label, int location);
+	int findExtension(const StringRef &extension) const;
+};
@@ -0,0 +1,46 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   MimeTypes.hpp                                      :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: ewiese-m <ewiese-m@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/08/29 09:12:48 by ewiese-m          #+#    #+#             */
+/*   Updated: 2025/08/29 09:12:48 by ewiese-m         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#pragma once
+
+#include "NameTable.hpp"
+#include "StringRef.hpp"
+#include <map>
+#include <string>
+#include <vector>
+
+/*
+** Extension -> content type table, filled at startup from the built-in
+** defaults plus any `types { }` blocks and included mime.types files. Keys
+** live in a case-insensitive NameTable; each distinct type string is
+** interned once and entries refer to it by index, so lookup() hands back a
+** reference and allocates nothing.
+*/
+class MimeTypes
+{
+  public:
+	MimeTypes();
+	void add(const std::string &type, const std::string &extension);
+	void addLine(const std::string &line);
+	void load(const std::string &path);
+	void setDefault(const std::string &type);
+	const std::string &lookup(const StringRef &path) const;
+	size_t size() const;
+
+  private:
+	static const size_t MAX_EXTENSION = 32;
+	std::vector<std::string> types_;
+	std::map<std::string, int> interned_;
+	NameTable<int> extensions_;
+	int default_type_;
+	int intern(const std::string &type);
+};
@@ -0,0 +1,189 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   NameTable.hpp                                      :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: ewiese-m <ewiese-m@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/08/31 18:02:11 by ewiese-m          #+#    #+#             */
+/*   Updated: 2025/08/31 18:02:11 by ewiese-m         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#pragma once
+
+#include <cctype>
+#include <string>
+#include <vector>
+
+/*
+** Open-addressing hash table keyed by case-insensitive names, behind both the
+** virtual host indexes and the MIME type table. Keys are stored lower-cased;
+** hashing and comparison fold case on the fly, so lookups can probe with
+** bytes straight from the request without copying them first. Linear
+** probing over a power-of-two table kept at most half full.
+*/
+template <typename T>
+class NameTable
+{
+  public:
+	NameTable();
+	bool insert(const std::string &name, const T &value);
+	void assign(const std::string &name, const T &value);
+	const T *find(const char *name, size_t length) const;
+	size_t size() const;
+
+  private:
+	struct Slot
+	{
+		unsigned int hash;
+		bool used;
+		std::string name;
+		T value;
+	};
+	std::vector<Slot> slots_;
+	size_t count_;
+	static unsigned char fold(char c);
+	static unsigned int hash(const char *name, size_t length);
+	size_t probe(const char *name, size_t length, unsigned int hash) const;
+	size_t claim(const std::string &name);
+	void grow();
+};
+
+template <typename T>
+NameTable<T>::NameTable() : slots_(), count_(0)
+{
+}
+
+/*
+** Adds name unless it is already taken, in which case the first value keeps
+** it and false is returned.
+*/
+template <typename T>
+bool NameTable<T>::insert(const std::string &name, const T &value)
+{
+	size_t before = count_;
+	size_t i = claim(name);
+
+	if (count_ == before)
+		return (false);
+	slots_[i].value = value;
+	return (true);
+}
+
+/*
+** Adds name or replaces the value it already has.
+*/
+template <typename T>
+void NameTable<T>::assign(const std::string &name, const T &value)
+{
+	slots_[claim(name)].value = value;
+}
+
+template <typename T>
+const T *NameTable<T>::find(const char *name, size_t length) const
+{
+	size_t i;
+
+	if (count_ == 0)
+		return (NULL);
+	i = probe(name, length, hash(name, length));
+	if (!slots_[i].used)
+		return (NULL);
+	return (&slots_[i].value);
+}
+
+template <typename T>
+size_t NameTable<T>::size() const
+{
+	return (count_);
+}
+
+template <typename T>
+unsigned char NameTable<T>::fold(char c)
+{
+	return (std::tolower(static_cast<unsigned char>(c)));
+}
+
+/*
+** FNV-1a over the lower-cased bytes.
+*/
+template <typename T>
+unsigned int NameTable<T>::hash(const char *name, size_t length)
+{
+	unsigned int hash = 2166136261u;
+
+	for (size_t i = 0; i < length; i++)
+	{
+		hash ^= fold(name[i]);
+		hash *= 16777619u;
+	}
+	return (hash);
+}
+
+/*
+** Slot holding name, or the empty slot where it would go.
+*/
+template <typename T>
+size_t NameTable<T>::probe(const char *name, size_t length,
+	unsigned int hash) const
+{
+	size_t mask = slots_.size() - 1;
+	size_t i;
+	size_t j;
+
+	for (i = hash & mask; slots_[i].used; i = (i + 1) & mask)
+	{
+		if (slots_[i].hash != hash || slots_[i].name.length() != length)
+			continue;
+		j = 0;
+		while (j < length && slots_[i].name[j] == fold(name[j]))
+			j++;
+		if (j == length)
+			break;
+	}
+	return (i);
+}
+
+/*
+** Slot for name, taking an empty one (and counting it) if name is new.
+*/
+template <typename T>
+size_t NameTable<T>::claim(const std::string &name)
+{
+	unsigned int key_hash;
+	size_t i;
+
+	if ((count_ + 1) * 2 > slots_.size())
+		grow();
+	key_hash = hash(name.data(), name.length());
+	i = probe(name.data(), name.length(), key_hash);
+	if (!slots_[i].used)
+	{
+		slots_[i].hash = key_hash;
+		slots_[i].used = true;
+		slots_[i].name = name;
+		for (size_t j = 0; j < name.length(); j++)
+			slots_[i].name[j] = fold(name[j]);
+		count_++;
+	}
+	return (i);
+}
+
+template <typename T>
+void NameTable<T>::grow()
+{
+	std::vector<Slot> old;
+	Slot empty;
+
+	empty.hash = 0;
+	empty.used = false;
+	empty.value = T();
+	old.swap(slots_);
+	slots_.assign(old.empty() ? 16 : old.size() * 2, empty);
+	for (size_t j = 0; j < old.size(); j++)
+	{
+		if (old[j].used)
+			slots_[probe(old[j].name.data(), old[j].name.length(), old[j].hash)] = old[j];
+	}
+}
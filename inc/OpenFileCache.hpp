@@ -0,0 +1,89 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   OpenFileCache.hpp                                  :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: ewiese-m <ewiese-m@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/08/24 11:02:17 by ewiese-m          #+#    #+#             */
+/*   Updated: 2025/08/24 11:02:17 by ewiese-m         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#pragma once
+
+#include <ctime>
+#include <list>
+#include <map>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+/*
+** Result of opening a path: the fd plus the metadata the static path needs.
+** A failed open is an entry too, with err set, so repeated misses are
+** answered from the cache. Entries are reference counted because an output
+** queue may still be streaming from the fd after the cache drops it.
+*/
+struct OpenFile
+{
+	std::string path;
+	int fd;
+	int err;
+	bool is_dir;
+	off_t size;
+	time_t mtime;
+	ino_t inode;
+	dev_t device;
+	time_t validated;
+	time_t accessed;
+	int refs;
+	std::list<OpenFile *>::iterator lru;
+
+	static OpenFile *retain(OpenFile *file);
+	static void release(OpenFile *file);
+};
+
+/*
+** nginx-style open file cache keyed by resolved path. A hit that is younger
+** than the validity window costs no syscalls at all; an older one is checked
+** with a single stat() and reopened only if the inode, size or mtime moved.
+** Entries unused for `inactive` seconds, and the least recently used ones
+** beyond `max`, are dropped by sweep(), which runs between event batches so
+** pointers handed out while serving a request stay valid until it is done.
+**
+** Lookups that only need metadata (conditional requests that may end in a 304)
+** pass need_fd = false: a miss is then resolved with stat() alone, and the
+** entry is upgraded with an open() the first time an fd is wanted.
+**
+** With max == 0 the cache is disabled and every lookup opens the file afresh;
+** such entries, and errors when error caching is off, are released by the
+** next sweep() as well.
+*/
+class OpenFileCache
+{
+  public:
+	OpenFileCache();
+	~OpenFileCache();
+	void configure(size_t max, time_t inactive, time_t valid, bool errors);
+	OpenFile *open(const std::string &path, time_t now, bool need_fd = true);
+	void invalidate(const std::string &path);
+	void invalidatePrefix(const std::string &prefix);
+	void sweep(time_t now);
+	size_t size() const;
+
+  private:
+	typedef std::map<std::string, OpenFile *> Index;
+	Index index_;
+	std::list<OpenFile *> lru_;
+	std::vector<OpenFile *> transient_;
+	size_t max_;
+	time_t inactive_;
+	time_t valid_;
+	bool errors_;
+	static OpenFile *load(const std::string &path, time_t now, bool need_fd);
+	bool stillValid(OpenFile *file, time_t now) const;
+	void drop(Index::iterator it);
+	OpenFileCache(const OpenFileCache &);
+	OpenFileCache &operator=(const OpenFileCache &);
+};
@@ -0,0 +1,74 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   OutputQueue.hpp                                    :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: ewiese-m <ewiese-m@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/08/19 17:40:31 by ewiese-m          #+#    #+#             */
+/*   Updated: 2025/08/19 17:40:31 by ewiese-m         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#pragma once
+
+#include "OpenFileCache.hpp"
+#include "SharedBuffer.hpp"
+#include <deque>
+#include <string>
+#include <sys/types.h>
+
+/*
+** Bytes waiting to be written to a client socket. Responses are appended
+** here and flushed whenever the socket is writable; a flush that would block
+** keeps the remainder queued for the next POLLOUT.
+**
+** Besides in-memory data, a segment can be a range of an open file, which is
+** sent with sendfile() straight from the page cache, or a shared buffer from
+** the content cache. The queue holds a reference on files and shared buffers
+** until they have been sent or dropped.
+*/
+
+enum FlushResult
+{
+	FLUSH_DONE,
+	FLUSH_AGAIN,
+	FLUSH_ERROR
+};
+
+class OutputQueue
+{
+  public:
+	OutputQueue();
+	~OutputQueue();
+	void append(const std::string &data);
+	void append(const char *data, size_t length);
+	void appendOwned(std::string &data);
+	void appendFile(OpenFile *file, off_t offset, off_t length);
+	void appendShared(SharedBuffer *buffer);
+	bool empty() const;
+	size_t pending() const;
+	FlushResult flush(int fd);
+	void clear();
+
+  private:
+	struct Segment
+	{
+		std::string data;
+		size_t offset;
+		bool sealed;
+		SharedBuffer *shared;
+		OpenFile *file;
+		off_t file_offset;
+		off_t file_remaining;
+	};
+	std::deque<Segment> segments_;
+	size_t pending_;
+	FlushResult flushMemory(int fd);
+	FlushResult flushFile(int fd, Segment &segment);
+	void popFront();
+	static const char *bytes(const Segment &segment);
+	static size_t length(const Segment &segment);
+	OutputQueue(const OutputQueue &);
+	OutputQueue &operator=(const OutputQueue &);
+};
@@ -0,0 +1,111 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   Poller.hpp                                         :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: ewiese-m <ewiese-m@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/08/18 11:02:14 by ewiese-m          #+#    #+#             */
+/*   Updated: 2025/08/18 11:02:14 by ewiese-m         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#pragma once
+
+#include <poll.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#ifdef __linux__
+# include <sys/epoll.h>
+#endif
+
+/*
+** Readiness notification backend used by WebServer::mainLoop. Every fd is
+** registered with a kind (listener, client...) and an id, which come back in
+** each PollEvent so the loop never has to search its own tables to find out
+** what a ready fd is.
+*/
+
+enum PollerEvent
+{
+	POLLER_IN = 1,
+	POLLER_OUT = 2,
+	POLLER_ERR = 4
+};
+
+struct PollEvent
+{
+	int fd;
+	int kind;
+	int id;
+	unsigned int events;
+};
+
+class Poller
+{
+  public:
+	virtual ~Poller();
+	virtual bool add(int fd, unsigned int events, int kind, int id) = 0;
+	virtual bool modify(int fd, unsigned int events) = 0;
+	virtual void remove(int fd) = 0;
+	virtual int wait(std::vector<PollEvent> &events, int timeout_ms) = 0;
+	virtual const char *name() const = 0;
+	virtual bool isEdgeTriggered() const;
+	static Poller *create(const std::string &backend, bool edge_triggered);
+
+  protected:
+	struct Registration
+	{
+		int kind;
+		int id;
+		unsigned int events;
+	};
+	std::vector<Registration> regs_;
+	Poller();
+	void remember(int fd, unsigned int events, int kind, int id);
+
+  private:
+	Poller(const Poller &);
+	Poller &operator=(const Poller &);
+};
+
+class PollPoller : public Poller
+{
+  public:
+	PollPoller();
+	~PollPoller();
+	bool add(int fd, unsigned int events, int kind, int id);
+	bool modify(int fd, unsigned int events);
+	void remove(int fd);
+	int wait(std::vector<PollEvent> &events, int timeout_ms);
+	const char *name() const;
+
+  private:
+	std::vector<struct pollfd> fds_;
+	std::vector<int> index_;
+};
+
+#ifdef __linux__
+
+class EpollPoller : public Poller
+{
+  public:
+	EpollPoller(bool edge_triggered);
+	~EpollPoller();
+	bool add(int fd, unsigned int events, int kind, int id);
+	bool modify(int fd, unsigned int events);
+	void remove(int fd);
+	int wait(std::vector<PollEvent> &events, int timeout_ms);
+	const char *name() const;
+	bool isEdgeTriggered() const;
+
+  private:
+	int epfd_;
+	bool edge_triggered_;
+	std::vector<struct epoll_event> ready_;
+	uint32_t toEpoll(unsigned int events) const;
+	static uint64_t pack(int fd, int kind, int id);
+};
+
+#endif
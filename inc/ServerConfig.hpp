@@ -1,6 +1,8 @@
 #pragma once
 
 #include "LocationConfig.hpp"
+#include "LocationRouter.hpp"
+#include "StringRef.hpp"
 #include <map>
 #include <string>
 #include <vector>
@@ -16,9 +18,12 @@ class ServerConfig
 	void setPort(int port);
 	int _port;
 	std::string _host;
+	bool _default_server;
 	std::vector<std::string> _server_names;
 	std::map<int, std::string> _error_pages;
 	size_t _client_max_body_size;
 	std::vector<LocationConfig> _locations;
-	const LocationConfig &findLocationForRequest(const std::string &uri_path) const;
+	LocationRouter _router;
+	void compileLocations();
+	const LocationConfig &findLocationForRequest(const StringRef &uri) const;
 };
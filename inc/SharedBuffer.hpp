@@ -0,0 +1,38 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   SharedBuffer.hpp                                   :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: ewiese-m <ewiese-m@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/08/25 18:44:09 by ewiese-m          #+#    #+#             */
+/*   Updated: 2025/08/25 18:44:09 by ewiese-m         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#pragma once
+
+#include <string>
+
+/*
+** Immutable, reference-counted byte buffer. Cached responses are built once
+** into shared buffers and queued on any number of connections without being
+** copied; the last release() frees the bytes.
+*/
+class SharedBuffer
+{
+  public:
+	static SharedBuffer *create(const std::string &data);
+	SharedBuffer *retain();
+	void release();
+	const char *data() const;
+	size_t size() const;
+
+  private:
+	std::string data_;
+	int refs_;
+	SharedBuffer(const std::string &data);
+	~SharedBuffer();
+	SharedBuffer(const SharedBuffer &);
+	SharedBuffer &operator=(const SharedBuffer &);
+};
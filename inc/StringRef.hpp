@@ -0,0 +1,42 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   StringRef.hpp                                      :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: ewiese-m <ewiese-m@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/08/25 09:51:26 by ewiese-m          #+#    #+#             */
+/*   Updated: 2025/08/25 09:51:26 by ewiese-m         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#pragma once
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+
+/*
+** Non-owning view of a run of bytes, typically inside a connection buffer.
+** It stays valid only as long as the storage it points into is not modified.
+*/
+
+struct StringRef
+{
+	const char *data;
+	size_t length;
+	StringRef();
+	StringRef(const char *ptr, size_t len);
+	explicit StringRef(const char *literal);
+	StringRef(const std::string &str);
+	bool empty() const;
+	size_t size() const;
+	std::string str() const;
+	bool equalsIgnoreCase(const char *literal) const;
+	bool equalsIgnoreCase(const StringRef &other) const;
+	bool operator==(const char *literal) const;
+	bool operator!=(const char *literal) const;
+	bool operator==(const StringRef &other) const;
+};
+
+std::ostream &operator<<(std::ostream &os, const StringRef &ref);
@@ -0,0 +1,53 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   TimerWheel.hpp                                     :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: ewiese-m <ewiese-m@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/08/21 10:15:48 by ewiese-m          #+#    #+#             */
+/*   Updated: 2025/08/21 10:15:48 by ewiese-m         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#pragma once
+
+#include <ctime>
+#include <vector>
+
+/*
+** Hashed timing wheel with one-second slots, keyed by a small integer id (the
+** client fd). Each slot is an intrusive doubly linked list threaded through
+** per-id arrays, so scheduling and cancelling never allocate once the arrays
+** have grown to the highest fd.
+**
+** Pushing a deadline further out is lazy: only the stored deadline changes,
+** and the entry is moved to its real slot when the wheel reaches the old one.
+** Deadlines beyond one revolution are handled the same way.
+*/
+
+class TimerWheel
+{
+  public:
+	TimerWheel(size_t slots = 64);
+	~TimerWheel();
+	void schedule(int id, time_t deadline);
+	void cancel(int id);
+	void expire(time_t now, std::vector<int> &expired);
+	int nextTimeout(time_t now) const;
+	bool empty() const;
+
+  private:
+	std::vector<int> heads_;
+	std::vector<int> next_;
+	std::vector<int> prev_;
+	std::vector<int> slot_;
+	std::vector<time_t> deadline_;
+	time_t current_;
+	size_t count_;
+	void link(int id, size_t slot);
+	void unlink(int id);
+	size_t slotFor(time_t deadline) const;
+	TimerWheel(const TimerWheel &);
+	TimerWheel &operator=(const TimerWheel &);
+};
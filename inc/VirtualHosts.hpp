@@ -0,0 +1,65 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   VirtualHosts.hpp                                   :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: ewiese-m <ewiese-m@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/08/28 15:40:22 by ewiese-m          #+#    #+#             */
+/*   Updated: 2025/08/28 15:40:22 by ewiese-m         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#pragma once
+
+#include "NameTable.hpp"
+#include "ServerConfig.hpp"
+#include "StringRef.hpp"
+#include <string>
+#include <vector>
+
+/*
+** Server selection, built once at startup. Servers are grouped into one
+** listener per distinct host:port; each listener indexes its server_names
+** in three case-insensitive NameTables (exact names, "*.example.com" and
+** "www.example.*"), so resolving a Host header costs one probe for an exact
+** name plus one per dot for wildcards. Precedence follows nginx: exact name,
+** longest leading wildcard, longest trailing wildcard, then the listener's
+** default_server (the first server of the group unless one is marked).
+**
+** A specific address on a port that also has a 0.0.0.0 listener is not
+** bound separately: connections arrive on the wildcard socket and
+** byLocalAddress() maps them to the specific listener.
+*/
+class VirtualHosts
+{
+  public:
+	struct Listener
+	{
+		std::string host;
+		int port;
+		std::vector<const ServerConfig *> servers;
+		const ServerConfig *default_server;
+		bool bound;
+		bool shadows;
+	};
+	VirtualHosts();
+	void build(const std::vector<ServerConfig> &servers);
+	size_t size() const;
+	const Listener &listener(size_t id) const;
+	size_t byLocalAddress(size_t id, const std::string &host) const;
+	const ServerConfig *resolve(size_t id, const StringRef &host) const;
+
+  private:
+	typedef NameTable<const ServerConfig *> ServerNames;
+	struct Index
+	{
+		ServerNames exact;
+		ServerNames leading;
+		ServerNames trailing;
+	};
+	static const size_t MAX_HOST_LENGTH = 255;
+	std::vector<Listener> listeners_;
+	std::vector<Index> indexes_;
+	void addName(size_t id, const std::string &name, const ServerConfig *server);
+};
@@ -13,32 +13,60 @@
 #ifndef WEBSERVER_HPP
 # define WEBSERVER_HPP
 
+# include "Compressor.hpp"
+# include "ConnectionPool.hpp"
+# include "ContentCache.hpp"
+# include "DirectoryListing.hpp"
+# include "ErrorPages.hpp"
+# include "MimeTypes.hpp"
+# include "OpenFileCache.hpp"
+# include "Poller.hpp"
 # include "ServerConfig.hpp"
+# include "TimerWheel.hpp"
+# include "VirtualHosts.hpp"
+# include "utils.hpp"
 # include <netinet/in.h>
-# include <poll.h>
 # include <string>
+# include <sys/types.h>
 # include <vector>
 
+class	Config;
 class	HttpRequest;
 class	HttpResponse;
 class	LocationConfig;
-struct ClientConnection;
 
 class WebServer
 {
   public:
-	WebServer(const std::vector<ServerConfig> &servers);
+	WebServer(const Config &config);
 	~WebServer();
 	void run();
 
   private:
+	enum FdKind
+	{
+		FD_LISTENER,
+		FD_CLIENT,
+		FD_NOTIFY
+	};
+	typedef void (WebServer::*MethodHandler)(ClientConnection &conn,
+		const HttpRequest &request, const LocationConfig &location);
+	static const MethodHandler METHOD_HANDLERS[HttpRequest::METHOD_COUNT];
 	void setupSockets();
+	void runWorker();
+	void runMaster();
+	pid_t spawnWorker(int worker_id);
 	void mainLoop();
-	void acceptNewConnection(int server_fd);
+	void acceptNewConnection(int server_fd, int listener);
 	void handleClientData(int client_fd);
+	bool readClient(ClientConnection &conn);
+	void handleClientWrite(int client_fd);
+	void serviceRequests(ClientConnection &conn);
+	bool flushClient(ClientConnection &conn);
 	void removeClient(int client_fd);
 	void checkTimeouts();
-	bool isCompleteRequest(const std::string &buffer);
+	bool requestTooLarge(ClientConnection &conn);
+	void resolveServer(ClientConnection &conn);
 	void processRequest(ClientConnection &conn);
 	void handleGetRequest(ClientConnection &conn, const HttpRequest &request,
 		const LocationConfig &location);
@@ -52,17 +80,64 @@ class WebServer
 		const LocationConfig &location, const std::string &script_path);
 	void handleFileUpload(ClientConnection &conn, const HttpRequest &request,
 		const LocationConfig &location);
-	void serveStaticFile(int client_fd, const std::string &file_path,
-		bool head_only = false);
-	void sendResponse(int client_fd, const HttpResponse &response);
-	void sendErrorResponse(int client_fd, int code, const std::string &message,
-		const ServerConfig *server = NULL);
-	void sendRedirectResponse(int client_fd, int code,
-		const std::string &location);
-	static std::string toString(int num);
+	void sendDirectoryListing(ClientConnection &conn,
+		const HttpRequest &request, const LocationConfig &location,
+		const std::string &dir_path, const std::string &uri);
+	OpenFile *openPrecompressed(const HttpRequest &request,
+		const std::string &file_path, const char **encoding, bool need_fd);
+	void serveStaticFile(ClientConnection &conn, const HttpRequest &request,
+		const LocationConfig &location, OpenFile *file,
+		const std::string &file_path, const char *encoding);
+	bool rangeStillValid(const HttpRequest &request,
+		const OpenFile &file) const;
+	bool notModified(const HttpRequest &request, const std::string &etag,
+		time_t mtime) const;
+	void sendNotModified(ClientConnection &conn, const LocationConfig &location,
+		const std::string &etag, time_t mtime, const char *vary);
+	void serveRanges(ClientConnection &conn, const LocationConfig &location,
+		OpenFile *file, const std::string &file_path, const char *encoding,
+		bool satisfiable, bool head_only);
+	static void addCacheHeaders(HttpResponse &response,
+		const LocationConfig &location);
+	static void appendCacheHeaders(std::string &block,
+		const LocationConfig &location);
+	bool negotiateCompression(const HttpRequest &request,
+		const LocationConfig &location, const std::string &content_type,
+		size_t length, Compressor::Format *format) const;
+	void compressResponse(const HttpRequest &request,
+		const LocationConfig &location, HttpResponse &response);
+	void sendRawResponse(ClientConnection &conn, const HttpRequest &request,
+		const LocationConfig &location, std::string &response);
+	void sendResponse(ClientConnection &conn, HttpResponse &response);
+	void sendErrorResponse(ClientConnection &conn, int code,
+		const std::string &message);
+	void sendRedirectResponse(ClientConnection &conn, int code,
+		const std::string &target, const LocationConfig *location = NULL);
+	static std::string toString(long num);
+	static std::string entityTag(const OpenFile &file);
+	static std::string listingTag(const DirectorySnapshot &dir, bool json);
+	static void addValidators(HttpResponse &response, const OpenFile &file);
 	std::vector<ServerConfig> _servers;
-	std::vector<struct pollfd> _poll_fds;
+	VirtualHosts _vhosts;
+	MimeTypes _mime_types;
+	ErrorPages _error_pages;
+	std::string _event_backend;
+	bool _edge_triggered;
+	int _worker_processes;
+	bool _worker_cpu_affinity;
+	int _worker_id;
+	Poller *_poller;
+	std::vector<PollEvent> _events;
+	ConnectionPool _clients;
+	TimerWheel _timers;
+	OpenFileCache _open_files;
+	ContentCache _content_cache;
+	DirectoryCache _directories;
+	std::vector<int> _expired;
+	std::vector<ByteRange> _ranges;
 	std::vector<int> _server_fds;
+	WebServer(const WebServer &);
+	WebServer &operator=(const WebServer &);
 };
 
 #endif
@@ -12,10 +12,25 @@
 
 #pragma once
 
+#include "StringRef.hpp"
 #include <ctime>
 #include <string>
+#include <sys/types.h>
 #include <vector>
 
+struct ByteRange
+{
+	off_t first;
+	off_t last;
+};
+
+enum RangeResult
+{
+	RANGE_NONE,
+	RANGE_OK,
+	RANGE_UNSATISFIABLE
+};
+
 bool	isDirectory(const std::string &path);
 bool	isFile(const std::string &path);
 bool	fileExists(const std::string &path);
@@ -25,11 +40,14 @@ bool	isExecutable(const std::string &path);
 size_t	getFileSize(const std::string &path);
 std::string readFile(const std::string &path);
 bool	writeFile(const std::string &path, const std::string &content);
-std::string generateDirectoryListing(const std::string &path,
-	const std::string &uri);
+bool	writeFile(const std::string &path, const char *data, size_t length);
 std::string formatFileSize(size_t size);
 std::string formatTime(time_t timestamp);
-std::string getMimeType(const std::string &path);
+std::string formatHttpDate(time_t timestamp);
+StringRef	pathExtension(const StringRef &path);
+bool	isCompressedMimeType(const std::string &mime);
+bool	acceptsEncoding(const StringRef &header, const char *coding);
+double	mediaTypeQuality(const StringRef &header, const char *type);
 std::string urlDecode(const std::string &str);
 std::string urlEncode(const std::string &str);
 std::string trim(const std::string &str);
@@ -38,3 +56,5 @@ std::string toUpperCase(const std::string &str);
 std::vector<std::string> split(const std::string &str, char delimiter);
 std::string join(const std::vector<std::string> &strings,
 	const std::string &delimiter);
+RangeResult parseByteRanges(const StringRef &header, off_t size,
+	std::vector<ByteRange> &ranges, size_t max_ranges);
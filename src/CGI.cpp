@@ -11,8 +11,10 @@
 /* ************************************************************************** */
 
 #include "../inc/CGI.hpp"
+#include "../inc/Clock.hpp"
 #include "../inc/HttpRequest.hpp"
 #include "../inc/LocationConfig.hpp"
+#include "../inc/Scanner.hpp"
 #include <cctype>
 #include <cerrno>
 #include <cstdlib>
@@ -74,13 +76,13 @@ void CGI::setupEnvironment()
     size_t query_pos;
 
     env_map_.clear();
-    env_map_["REQUEST_METHOD"] = request_.getMethod();
-    env_map_["SERVER_PROTOCOL"] = request_.getHttpVersion();
+    env_map_["REQUEST_METHOD"] = request_.getMethod().str();
+    env_map_["SERVER_PROTOCOL"] = request_.getHttpVersion().str();
     env_map_["GATEWAY_INTERFACE"] = "CGI/1.1";
     env_map_["SERVER_SOFTWARE"] = "webserv/1.0";
     env_map_["SERVER_NAME"] = "localhost";
     env_map_["SERVER_PORT"] = "8080";
-    std::string uri = request_.getUri();
+    std::string uri = request_.getUri().str();
     query_pos = uri.find('?');
     if (query_pos != std::string::npos)
     {
@@ -92,18 +94,15 @@ void CGI::setupEnvironment()
         env_map_["PATH_INFO"] = uri;
         env_map_["QUERY_STRING"] = "";
     }
-    const std::map<std::string, std::string> &headers = request_.getHeaders();
-    for (std::map<std::string,
-                  std::string>::const_iterator it = headers.begin();
-         it != headers.end(); ++it)
+    for (size_t i = 0; i < request_.getHeaderCount(); ++i)
     {
-        std::string env_name = "HTTP_" + toUpperSnakeCase(it->first);
-        env_map_[env_name] = it->second;
+        std::string env_name = "HTTP_" + toUpperSnakeCase(request_.getHeaderName(i).str());
+        env_map_[env_name] = request_.getHeaderValue(i).str();
     }
-    if (request_.getMethod() == "POST")
+    if (request_.getMethodId() == HttpRequest::METHOD_POST)
     {
-        std::string content_type = request_.getHeader("content-type");
-        std::string content_length = request_.getHeader("content-length");
+        std::string content_type = request_.getHeader(HttpRequest::HEADER_CONTENT_TYPE).str();
+        std::string content_length = request_.getHeader(HttpRequest::HEADER_CONTENT_LENGTH).str();
         if (!content_type.empty())
         {
             env_map_["CONTENT_TYPE"] = content_type;
@@ -172,10 +171,10 @@ std::string CGI::handleCGIParent(pid_t pid, int pipe_in[2], int pipe_out[2])
 
     close(pipe_in[0]);
     close(pipe_out[1]);
-    if (request_.getMethod() == "POST" && !request_.getBody().empty())
+    if (request_.getMethodId() == HttpRequest::METHOD_POST && !request_.getBody().empty())
     {
-        write(pipe_in[1], request_.getBody().c_str(),
-              request_.getBody().length());
+        write(pipe_in[1], request_.getBody().data,
+              request_.getBody().length);
     }
     close(pipe_in[1]);
     flags = fcntl(pipe_out[0], F_GETFL, 0);
@@ -216,37 +215,43 @@ std::string CGI::handleCGIParent(pid_t pid, int pipe_in[2], int pipe_out[2])
     {
         return (generateErrorResponse(500, "CGI script error"));
     }
-    return (parseCGIOutput(output));
+    parseCGIOutput(output);
+    return (output);
 }
 
-std::string CGI::parseCGIOutput(const std::string &raw_output)
+/*
+** Turns the script's output into a complete HTTP response in place: the
+** response head replaces the CGI header block in front of the body, which
+** is never copied.
+*/
+void CGI::parseCGIOutput(std::string &output)
 {
+    const char *blank;
     size_t separator;
+    size_t terminator;
     size_t status_pos;
     size_t status_end;
 
-    if (raw_output.empty())
+    if (output.empty())
     {
-        return (generateErrorResponse(500, "Empty CGI response"));
+        output = generateErrorResponse(500, "Empty CGI response");
+        return;
     }
-    separator = raw_output.find("\r\n\r\n");
-    if (separator == std::string::npos)
+    blank = scanBlankLine(output.data(), output.data() + output.length(), &terminator);
+    if (blank == NULL)
     {
-        separator = raw_output.find("\n\n");
-        if (separator == std::string::npos)
-        {
-            return "HTTP/1.1 200 OK\r\n"
-                   "Content-Type: text/html\r\n"
-                   "Content-Length: " +
-                   toString(raw_output.length()) +
-                   "\r\n"
-                   "Connection: close\r\n"
-                   "\r\n" +
-                   raw_output;
-        }
+        output.insert(0, "HTTP/1.1 200 OK\r\n"
+                         "Content-Type: text/html\r\n"
+                         "Content-Length: " +
+                             toString(output.length()) +
+                             "\r\n"
+                             "Connection: close\r\n" +
+                             Clock::dateHeader() +
+                             "\r\n");
+        return;
     }
-    std::string headers = raw_output.substr(0, separator);
-    std::string body = raw_output.substr(separator + (raw_output[separator] == '\r' ? 4 : 2));
+    separator = blank - output.data();
+    std::string headers = output.substr(0, separator);
     std::ostringstream response;
     if (headers.find("Status:") != std::string::npos)
     {
@@ -266,12 +271,15 @@ std::string CGI::parseCGIOutput(const std::string &raw_output)
     }
     if (headers.find("Content-Length:") == std::string::npos && headers.find("content-length:") == std::string::npos)
     {
-        response << "Content-Length: " << body.length() << "\r\n";
+        response << "Content-Length: " << output.length() - separator - terminator << "\r\n";
     }
     response << "Server: webserv/1.0\r\n";
+    if (headers.find("Date:") == std::string::npos && headers.find("date:") == std::string::npos)
+    {
+        response << Clock::dateHeader();
+    }
     response << "\r\n";
-    response << body;
-    return (response.str());
+    output.replace(0, separator + terminator, response.str());
 }
 
 std::string CGI::generateErrorResponse(int code, const std::string &message)
@@ -293,6 +301,7 @@ std::string CGI::generateErrorResponse(int code, const std::string &message)
     response << "Content-Type: text/html\r\n";
     response << "Content-Length: " << body.length() << "\r\n";
     response << "Connection: close\r\n";
+    response << Clock::dateHeader();
     response << "\r\n";
     response << body;
     return (response.str());
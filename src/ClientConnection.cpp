@@ -0,0 +1,53 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   ClientConnection.cpp                               :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: ewiese-m <ewiese-m@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/08/22 14:33:09 by ewiese-m          #+#    #+#             */
+/*   Updated: 2025/08/22 14:33:09 by ewiese-m         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "../inc/ClientConnection.hpp"
+
+ClientConnection::ClientConnection() : fd(-1), buffer(), request(),
+	keep_alive(false), listener(-1),
+	server(NULL), client_ip(), output(), header_buffer(), listing(),
+	close_after_write(false), input_pending(false), server_resolved(false)
+{
+}
+
+/*
+** Empties a buffer for the next connection. Storage up to RETAIN_CAPACITY is
+** kept; anything larger (a big upload, a pipelined burst) is handed back so
+** an idle slot does not pin the peak size of whatever used it last.
+*/
+static void releaseBuffer(std::string &data)
+{
+	if (data.capacity() > ClientConnection::RETAIN_CAPACITY)
+		std::string().swap(data);
+	else
+		data.clear();
+}
+
+/*
+** Clears the per-request state but keeps the buffers' storage around for the
+** next connection that lands in this slot, up to RETAIN_CAPACITY each.
+*/
+void ClientConnection::reset()
+{
+	fd = -1;
+	releaseBuffer(buffer);
+	request.reset();
+	keep_alive = false;
+	listener = -1;
+	server = NULL;
+	output.clear();
+	releaseBuffer(header_buffer);
+	listing.clear();
+	close_after_write = false;
+	input_pending = false;
+	server_resolved = false;
+}
@@ -0,0 +1,54 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   Clock.cpp                                          :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: ewiese-m <ewiese-m@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/08/27 14:02:37 by ewiese-m          #+#    #+#             */
+/*   Updated: 2025/08/27 14:02:37 by ewiese-m         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "../inc/Clock.hpp"
+#include "../inc/utils.hpp"
+
+time_t Clock::now_ = 0;
+time_t Clock::formatted_ = -1;
+std::string Clock::date_header_;
+
+/*
+** CLOCK_REALTIME_COARSE is served from the vDSO without reading the hardware
+** counter; its tick resolution is far finer than the one second we need.
+*/
+void Clock::update()
+{
+#ifdef CLOCK_REALTIME_COARSE
+	struct timespec ts;
+
+	if (clock_gettime(CLOCK_REALTIME_COARSE, &ts) == 0)
+		now_ = ts.tv_sec;
+	else
+		now_ = time(NULL);
+#else
+	now_ = time(NULL);
+#endif
+	if (now_ == formatted_)
+		return ;
+	formatted_ = now_;
+	date_header_ = "date: " + formatHttpDate(now_) + "\r\n";
+}
+
+time_t Clock::now()
+{
+	if (formatted_ < 0)
+		update();
+	return (now_);
+}
+
+const std::string &Clock::dateHeader()
+{
+	if (formatted_ < 0)
+		update();
+	return (date_header_);
+}
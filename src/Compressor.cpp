@@ -0,0 +1,114 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   Compressor.cpp                                     :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: ewiese-m <ewiese-m@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/08/27 09:31:52 by ewiese-m          #+#    #+#             */
+/*   Updated: 2025/08/27 09:31:52 by ewiese-m         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "../inc/Compressor.hpp"
+#include <cstring>
+
+static const size_t CHUNK_SIZE = 16384;
+static const int MAX_WINDOW_BITS = 15;
+static const int MIN_WINDOW_BITS = 10;
+static const int GZIP_WRAPPER = 16;
+
+/*
+** The window only needs to cover the body, so small responses get a smaller
+** window and hash table (the same trick nginx's gzip filter uses).
+*/
+Compressor::Compressor(Format format, int level, size_t size_hint) : ok_(false)
+{
+	int window_bits;
+	int mem_level;
+
+	window_bits = MAX_WINDOW_BITS;
+	while (window_bits > MIN_WINDOW_BITS
+		&& size_hint > 0 && size_hint < (1UL << (window_bits - 1)))
+		window_bits--;
+	mem_level = window_bits - 7;
+	if (mem_level > 8)
+		mem_level = 8;
+	std::memset(&stream_, 0, sizeof(stream_));
+	if (format == FORMAT_GZIP)
+		window_bits += GZIP_WRAPPER;
+	ok_ = deflateInit2(&stream_, level, Z_DEFLATED, window_bits, mem_level,
+			Z_DEFAULT_STRATEGY) == Z_OK;
+}
+
+Compressor::~Compressor()
+{
+	if (ok_)
+		deflateEnd(&stream_);
+}
+
+bool Compressor::ok() const
+{
+	return (ok_);
+}
+
+bool Compressor::update(const char *data, size_t length, std::string &out)
+{
+	return (run(data, length, Z_NO_FLUSH, out));
+}
+
+bool Compressor::finish(std::string &out)
+{
+	return (run(NULL, 0, Z_FINISH, out));
+}
+
+const char *Compressor::encodingName(Format format)
+{
+	if (format == FORMAT_GZIP)
+		return ("gzip");
+	return ("deflate");
+}
+
+/*
+** One-shot helper: feeds [data, data + length) through update() a chunk at a
+** time, straight from the caller's buffer.
+*/
+bool Compressor::compress(Format format, int level, const char *data,
+	size_t length, std::string &out)
+{
+	Compressor compressor(format, level, length);
+	size_t offset;
+	size_t step;
+
+	if (!compressor.ok())
+		return (false);
+	for (offset = 0; offset < length; offset += step)
+	{
+		step = length - offset < CHUNK_SIZE ? length - offset : CHUNK_SIZE;
+		if (!compressor.update(data + offset, step, out))
+			return (false);
+	}
+	return (compressor.finish(out));
+}
+
+bool Compressor::run(const char *data, size_t length, int flush,
+	std::string &out)
+{
+	unsigned char chunk[CHUNK_SIZE];
+	int result;
+
+	if (!ok_)
+		return (false);
+	stream_.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data));
+	stream_.avail_in = length;
+	do
+	{
+		stream_.next_out = chunk;
+		stream_.avail_out = sizeof(chunk);
+		result = deflate(&stream_, flush);
+		if (result == Z_STREAM_ERROR)
+			return (false);
+		out.append(reinterpret_cast<char *>(chunk), sizeof(chunk) - stream_.avail_out);
+	} while (stream_.avail_out == 0);
+	return (flush != Z_FINISH || result == Z_STREAM_END);
+}
@@ -11,14 +11,27 @@
 /* ************************************************************************** */
 
 #include "../inc/Config.hpp"
+#include "../inc/HttpRequest.hpp"
 #include <fstream>
 #include <sstream>
 #include <cstdlib>
 #include <iostream>
 #include <algorithm>
 #include <cctype>
-
-Config::Config(const std::string &file_path) : _servers() {
+#include <cerrno>
+#include <climits>
+#include <unistd.h>
+
+Config::Config(const std::string &file_path) : _servers(), _event_backend(""),
+                                               _edge_triggered(false), _worker_processes(1),
+                                               _worker_cpu_affinity(false),
+                                               _open_file_cache_max(0),
+                                               _open_file_cache_inactive(60),
+                                               _open_file_cache_valid(60),
+                                               _open_file_cache_errors(true),
+                                               _static_cache_max(0),
+                                               _static_cache_entry_max(65536),
+                                               _mime_types(), _config_dir(".") {
     parse(file_path);
 }
 
@@ -28,6 +41,50 @@ const std::vector<ServerConfig> &Config::getServers() const {
     return _servers;
 }
 
+const std::string &Config::getEventBackend() const {
+    return _event_backend;
+}
+
+bool Config::isEdgeTriggered() const {
+    return _edge_triggered;
+}
+
+int Config::getWorkerProcesses() const {
+    return _worker_processes;
+}
+
+bool Config::getWorkerCpuAffinity() const {
+    return _worker_cpu_affinity;
+}
+
+const MimeTypes &Config::getMimeTypes() const {
+    return _mime_types;
+}
+
+size_t Config::getOpenFileCacheMax() const {
+    return _open_file_cache_max;
+}
+
+time_t Config::getOpenFileCacheInactive() const {
+    return _open_file_cache_inactive;
+}
+
+time_t Config::getOpenFileCacheValid() const {
+    return _open_file_cache_valid;
+}
+
+bool Config::getOpenFileCacheErrors() const {
+    return _open_file_cache_errors;
+}
+
+size_t Config::getStaticCacheMax() const {
+    return _static_cache_max;
+}
+
+size_t Config::getStaticCacheEntryMax() const {
+    return _static_cache_entry_max;
+}
+
 
 static std::string trim(const std::string &str) {
     size_t first = str.find_first_not_of(" \t\r\n");
@@ -54,7 +111,12 @@ namespace {
         std::string method;
 
         while (iss >> method) {
-            methods.push_back(method);
+            if (method[method.length() - 1] == ';') {
+                method.erase(method.length() - 1);
+            }
+            if (!method.empty()) {
+                methods.push_back(method);
+            }
         }
 
 
@@ -64,6 +126,113 @@ namespace {
 
         return methods;
     }
+
+    /*
+    ** Permission checks at request time are a single AND against this mask.
+    */
+    unsigned int methodMask(const std::vector<std::string> &methods) {
+        unsigned int mask = 0;
+
+        for (size_t i = 0; i < methods.size(); i++) {
+            HttpRequest::Method method = HttpRequest::methodFromName(StringRef(methods[i]));
+            if (method == HttpRequest::METHOD_COUNT) {
+                throw std::runtime_error("Unknown method: " + methods[i]);
+            }
+            mask |= 1u << method;
+        }
+        return mask;
+    }
+
+    time_t parseSeconds(const std::string &value) {
+        char *end = NULL;
+        long seconds = strtol(value.c_str(), &end, 10);
+
+        if (end == value.c_str() || seconds < 0) {
+            throw std::runtime_error("Invalid time value: " + value);
+        }
+        if (*end == 'm') {
+            seconds *= 60;
+            end++;
+        } else if (*end == 'h') {
+            seconds *= 3600;
+            end++;
+        } else if (*end == 's') {
+            end++;
+        }
+        if (*end != '\0') {
+            throw std::runtime_error("Invalid time value: " + value);
+        }
+        return static_cast<time_t>(seconds);
+    }
+
+    /*
+    ** Rebuilds the caching headers of a location from its expires and
+    ** cache_control settings, so requests only copy finished strings. A
+    ** relative Expires still needs the clock and is formatted per response.
+    */
+    void updateCacheHeaders(LocationConfig &location) {
+        std::ostringstream cache_control;
+
+        location._expires_header.clear();
+        if (location._expires_mode == LocationConfig::EXPIRES_FIXED) {
+            location._expires_header = location._expires > 0
+                ? "Thu, 31 Dec 2037 23:55:55 GMT" : "Thu, 01 Jan 1970 00:00:01 GMT";
+        }
+        if (location._expires_mode != LocationConfig::EXPIRES_OFF) {
+            if (location._expires < 0 || (location._expires == 0
+                    && location._expires_mode == LocationConfig::EXPIRES_FIXED)) {
+                cache_control << "no-cache";
+            } else {
+                cache_control << "max-age=" << location._expires;
+            }
+        }
+        if (!location._cache_control.empty()) {
+            if (!cache_control.str().empty()) {
+                cache_control << ", ";
+            }
+            cache_control << location._cache_control;
+        }
+        location._cache_control_header = cache_control.str();
+    }
+
+    size_t parseSize(const std::string &value) {
+        char *end = NULL;
+        unsigned long size = strtoul(value.c_str(), &end, 10);
+
+        if (value.empty() || !std::isdigit(static_cast<unsigned char>(value[0]))) {
+            throw std::runtime_error("Invalid size value: " + value);
+        }
+        if (*end == 'k' || *end == 'K') {
+            size *= 1024;
+            end++;
+        } else if (*end == 'm' || *end == 'M') {
+            size *= 1024 * 1024;
+            end++;
+        }
+        if (*end != '\0') {
+            throw std::runtime_error("Invalid size value: " + value);
+        }
+        return size;
+    }
+
+    /*
+    ** A positive decimal count with nothing after it; strtoul alone would
+    ** take "-1", " 4" or "4k" and quietly make something of them.
+    */
+    size_t parseCount(const std::string &directive, const std::string &value) {
+        char *end = NULL;
+        unsigned long count;
+
+        if (value.empty() || !std::isdigit(static_cast<unsigned char>(value[0]))) {
+            throw std::runtime_error("Invalid " + directive + ": " + value);
+        }
+        errno = 0;
+        count = strtoul(value.c_str(), &end, 10);
+        if (*end != '\0' || errno == ERANGE || count == 0 || count > INT_MAX) {
+            throw std::runtime_error("Invalid " + directive + ": " + value);
+        }
+        return count;
+    }
 }
 
 void Config::parse(const std::string &config_file) {
@@ -71,6 +240,10 @@ void Config::parse(const std::string &config_file) {
     if (!file.is_open()) {
         throw std::runtime_error("Could not open config file: " + config_file);
     }
+    size_t slash = config_file.rfind('/');
+    if (slash != std::string::npos) {
+        _config_dir = config_file.substr(0, slash);
+    }
 
     std::string line;
     while (std::getline(file, line)) {
@@ -80,7 +253,9 @@ void Config::parse(const std::string &config_file) {
         if (line.empty()) continue;
 
 
-        if (line == "server {" || line == "server{") {
+        if (line == "types {" || line == "types{") {
+            parseTypesBlock(file);
+        } else if (line == "server {" || line == "server{") {
             bool closed = false;
             parseServerBlock(file, &closed);
             if (!closed) {
@@ -99,6 +274,14 @@ void Config::parse(const std::string &config_file) {
                     }
                 }
             }
+        } else {
+
+            std::istringstream iss(line);
+            std::string directive;
+            std::string value;
+            iss >> directive;
+            std::getline(iss, value);
+            parseGlobalDirective(directive, trim(value));
         }
     }
 
@@ -107,6 +290,111 @@ void Config::parse(const std::string &config_file) {
     }
 }
 
+/*
+** Body of a `types { }` block: "type ext ext;" entries, as in nginx.
+*/
+void Config::parseTypesBlock(std::istream &file) {
+    std::string line;
+
+    while (std::getline(file, line)) {
+        line = trim(removeComment(line));
+        if (line == "}") {
+            return;
+        }
+        _mime_types.addLine(line);
+    }
+    throw std::runtime_error("Unclosed types block");
+}
+
+/*
+** Directives outside server blocks. An unknown name is most likely a typo
+** for one of these, so it fails the load instead of being dropped.
+*/
+void Config::parseGlobalDirective(const std::string &directive, const std::string &value) {
+    if (directive == "include") {
+
+        std::string path = value;
+        if (!path.empty() && path[path.length() - 1] == ';') {
+            path.erase(path.length() - 1);
+        }
+        if (!path.empty() && path[0] != '/') {
+            path = _config_dir + "/" + path;
+        }
+        _mime_types.load(path);
+    } else if (directive == "default_type") {
+        _mime_types.setDefault(value);
+    } else if (directive == "use") {
+
+        if (value != "epoll" && value != "poll") {
+            throw std::runtime_error("Unknown event backend: " + value);
+        }
+        _event_backend = value;
+    } else if (directive == "edge_triggered") {
+        _edge_triggered = (value == "on");
+    } else if (directive == "worker_processes") {
+
+        if (value == "auto") {
+            long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+            _worker_processes = cpus > 0 ? static_cast<int>(cpus) : 1;
+        } else {
+            _worker_processes = static_cast<int>(parseCount("worker_processes", value));
+        }
+    } else if (directive == "worker_cpu_affinity") {
+        _worker_cpu_affinity = (value == "auto" || value == "on");
+    } else if (directive == "open_file_cache") {
+
+        _open_file_cache_max = 0;
+        if (value == "off") {
+            return;
+        }
+        std::istringstream iss(value);
+        std::string param;
+        while (iss >> param) {
+            if (param.compare(0, 4, "max=") == 0) {
+                _open_file_cache_max = parseCount("open_file_cache max", param.substr(4));
+            } else if (param.compare(0, 9, "inactive=") == 0) {
+                _open_file_cache_inactive = parseSeconds(param.substr(9));
+            } else {
+                throw std::runtime_error("Invalid open_file_cache parameter: " + param);
+            }
+        }
+        if (_open_file_cache_max == 0) {
+            throw std::runtime_error("open_file_cache needs max=N or off");
+        }
+    } else if (directive == "open_file_cache_valid") {
+        _open_file_cache_valid = parseSeconds(value);
+    } else if (directive == "open_file_cache_errors") {
+        _open_file_cache_errors = (value == "on");
+    } else if (directive == "static_cache") {
+
+        _static_cache_max = 0;
+        if (value == "off") {
+            return;
+        }
+        std::istringstream iss(value);
+        std::string param;
+        while (iss >> param) {
+            if (param.compare(0, 4, "max=") == 0) {
+                _static_cache_max = parseSize(param.substr(4));
+            } else if (param.compare(0, 10, "max_entry=") == 0) {
+                _static_cache_entry_max = parseSize(param.substr(10));
+            } else {
+                throw std::runtime_error("Invalid static_cache parameter: " + param);
+            }
+        }
+        if (_static_cache_max == 0) {
+            throw std::runtime_error("static_cache needs max=SIZE or off");
+        }
+    } else {
+        throw std::runtime_error("Unknown directive: " + directive);
+    }
+}
+
+/*
+** A location nested in another is flattened into a sibling of it; enclosing
+** counts the outer blocks whose closing '}' is still to come, so it does not
+** end the server block early.
+*/
 void Config::parseServerBlock(std::istream &file, bool *closed) {
     _servers.push_back(ServerConfig());
     ServerConfig &server = _servers.back();
@@ -119,6 +407,7 @@ void Config::parseServerBlock(std::istream &file, bool *closed) {
     std::string line;
     LocationConfig current_location;
     bool in_location = false;
+    int enclosing = 0;
 
     while (std::getline(file, line)) {
         line = removeComment(line);
@@ -142,6 +431,8 @@ void Config::parseServerBlock(std::istream &file, bool *closed) {
                 server._locations.push_back(current_location);
                 current_location = LocationConfig();
                 in_location = false;
+            } else if (enclosing > 0) {
+                enclosing--;
             } else {
 
                 *closed = true;
@@ -155,10 +446,14 @@ void Config::parseServerBlock(std::istream &file, bool *closed) {
         std::string directive;
         iss >> directive;
 
+        if (directive == "server") {
+            throw std::runtime_error("Unclosed block before nested server block");
+        }
         if (directive == "location") {
             if (in_location) {
 
                 server._locations.push_back(current_location);
+                enclosing++;
             }
 
 
@@ -225,15 +520,33 @@ void Config::parseServerBlock(std::istream &file, bool *closed) {
         default_loc._index_file = "index.html";
         default_loc._directory_listing = false;
         default_loc._allowed_methods.push_back("GET");
+        default_loc._allowed_mask = 1u << HttpRequest::METHOD_GET;
         server._locations.insert(server._locations.begin(), default_loc);
     }
+    server.compileLocations();
 }
 
 void Config::parseServerDirective(ServerConfig &server, const std::string &directive,
                                   const std::string &value) {
     if (directive == "listen") {
 
-        server._port = atoi(value.c_str());
+        std::istringstream iss(value);
+        std::string address;
+        std::string flag;
+        iss >> address;
+        size_t colon = address.rfind(':');
+        if (colon != std::string::npos) {
+            server._host = address.substr(0, colon);
+            address = address.substr(colon + 1);
+        }
+        server._port = atoi(address.c_str());
+        while (iss >> flag) {
+            if (flag == "default_server") {
+                server._default_server = true;
+            } else {
+                throw std::runtime_error("Unknown listen parameter: " + flag);
+            }
+        }
     } else if (directive == "host") {
         server._host = value;
     } else if (directive == "server_name") {
@@ -273,12 +586,9 @@ void Config::parseLocationDirective(LocationConfig &location, const std::string
         location._index_file = value;
     } else if (directive == "autoindex") {
         location._directory_listing = (value == "on");
-    } else if (directive == "allow") {
-
-        location._allowed_methods = parseMethods(value);
-    } else if (directive == "allow_methods") {
-
+    } else if (directive == "allow" || directive == "allow_methods") {
         location._allowed_methods = parseMethods(value);
+        location._allowed_mask = methodMask(location._allowed_methods);
     } else if (directive == "cgi_path") {
         location._cgi_path = value;
     } else if (directive == "cgi_extension" || directive == "cgi_ext") {
@@ -287,6 +597,49 @@ void Config::parseLocationDirective(LocationConfig &location, const std::string
         location._upload_path = value;
     } else if (directive == "return") {
         location._redirect = value;
+    } else if (directive == "static_compressed") {
+        location._static_compressed = (value == "on");
+    } else if (directive == "compress") {
+        location._compress = (value == "on");
+    } else if (directive == "compress_types") {
+
+        std::istringstream iss(value);
+        std::string type;
+        location._compress_types.assign(1, "text/html");
+        while (iss >> type) {
+            if (type != "text/html") {
+                location._compress_types.push_back(type);
+            }
+        }
+    } else if (directive == "compress_min_length") {
+        location._compress_min_length = parseSize(value);
+    } else if (directive == "expires") {
+
+        if (value == "off") {
+            location._expires_mode = LocationConfig::EXPIRES_OFF;
+        } else if (value == "max") {
+            location._expires_mode = LocationConfig::EXPIRES_FIXED;
+            location._expires = 315360000;
+        } else if (value == "epoch") {
+            location._expires_mode = LocationConfig::EXPIRES_FIXED;
+            location._expires = 0;
+        } else if (!value.empty() && value[0] == '-') {
+            location._expires_mode = LocationConfig::EXPIRES_RELATIVE;
+            location._expires = -parseSeconds(value.substr(1));
+        } else {
+            location._expires_mode = LocationConfig::EXPIRES_RELATIVE;
+            location._expires = parseSeconds(value);
+        }
+        updateCacheHeaders(location);
+    } else if (directive == "cache_control") {
+        location._cache_control = value;
+        updateCacheHeaders(location);
+    } else if (directive == "compress_level") {
+
+        location._compress_level = atoi(value.c_str());
+        if (location._compress_level < 1 || location._compress_level > 9) {
+            throw std::runtime_error("Invalid compress_level: " + value);
+        }
     } else if (directive == "client_max_body_size") {
 
 
@@ -0,0 +1,92 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   ConnectionPool.cpp                                 :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: ewiese-m <ewiese-m@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/08/22 14:33:09 by ewiese-m          #+#    #+#             */
+/*   Updated: 2025/08/22 14:33:09 by ewiese-m         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "../inc/ConnectionPool.hpp"
+
+ConnectionPool::ConnectionPool() : slots_(), index_(), free_(), active_(0)
+{
+}
+
+ConnectionPool::~ConnectionPool()
+{
+	for (size_t i = 0; i < slots_.size(); i++)
+		delete slots_[i];
+}
+
+void ConnectionPool::reserve(size_t connections, size_t max_fd)
+{
+	if (index_.size() < max_fd)
+		index_.resize(max_fd, -1);
+	free_.reserve(connections);
+	slots_.reserve(connections);
+	while (slots_.size() < connections)
+	{
+		slots_.push_back(new ClientConnection());
+		free_.push_back(slots_.size() - 1);
+	}
+}
+
+ClientConnection *ConnectionPool::acquire(int fd)
+{
+	int slot;
+
+	if (fd < 0)
+		return (NULL);
+	if (static_cast<size_t>(fd) >= index_.size())
+		index_.resize(fd + 1, -1);
+	if (index_[fd] != -1)
+		return (slots_[index_[fd]]);
+	if (free_.empty())
+	{
+		slots_.push_back(new ClientConnection());
+		slot = slots_.size() - 1;
+	}
+	else
+	{
+		slot = free_.back();
+		free_.pop_back();
+	}
+	index_[fd] = slot;
+	slots_[slot]->fd = fd;
+	active_++;
+	return (slots_[slot]);
+}
+
+ClientConnection *ConnectionPool::find(int fd)
+{
+	if (fd < 0 || static_cast<size_t>(fd) >= index_.size() || index_[fd] == -1)
+		return (NULL);
+	return (slots_[index_[fd]]);
+}
+
+void ConnectionPool::release(int fd)
+{
+	int slot;
+
+	if (fd < 0 || static_cast<size_t>(fd) >= index_.size() || index_[fd] == -1)
+		return ;
+	slot = index_[fd];
+	slots_[slot]->reset();
+	index_[fd] = -1;
+	free_.push_back(slot);
+	active_--;
+}
+
+size_t ConnectionPool::size() const
+{
+	return (active_);
+}
+
+int ConnectionPool::maxFd() const
+{
+	return (static_cast<int>(index_.size()) - 1);
+}
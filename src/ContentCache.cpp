@@ -0,0 +1,303 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   ContentCache.cpp                                   :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: ewiese-m <ewiese-m@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/08/25 18:44:09 by ewiese-m          #+#    #+#             */
+/*   Updated: 2025/08/25 18:44:09 by ewiese-m         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "../inc/ContentCache.hpp"
+#include <cerrno>
+#include <cstdio>
+#include <unistd.h>
+#ifdef __linux__
+# include <sys/inotify.h>
+#endif
+
+#ifdef __linux__
+static const uint32_t WATCH_MASK = IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB
+	| IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF
+	| IN_MOVE_SELF;
+#endif
+
+ContentCache::ContentCache() : index_(), lru_(), watches_(), watched_dirs_(),
+	max_total_(0), max_entry_(0), total_(0), notify_fd_(-1)
+{
+}
+
+ContentCache::~ContentCache()
+{
+	clear();
+	if (notify_fd_ >= 0)
+		close(notify_fd_);
+}
+
+void ContentCache::configure(size_t max_total, size_t max_entry)
+{
+	max_total_ = max_total;
+	max_entry_ = max_entry;
+}
+
+/*
+** Creates the inotify instance. Called in each worker after fork so that
+** every process gets its own event stream. Returns the fd to poll, or -1 when
+** the cache is off or inotify is unavailable.
+*/
+int ContentCache::start()
+{
+	if (max_total_ == 0 || notify_fd_ >= 0)
+		return (notify_fd_);
+#ifdef __linux__
+	notify_fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (notify_fd_ < 0)
+		perror("inotify_init1");
+#endif
+	return (notify_fd_);
+}
+
+bool ContentCache::enabled() const
+{
+	return (notify_fd_ >= 0);
+}
+
+/*
+** Entries are keyed by path, a NUL and the variant, so all variants of a path
+** sort together and invalidate() can drop them as one range.
+*/
+std::string ContentCache::key(const std::string &path,
+	const std::string &variant)
+{
+	std::string result;
+
+	result.reserve(path.size() + 1 + variant.size());
+	result.append(path);
+	result.push_back('\0');
+	result.append(variant);
+	return (result);
+}
+
+/*
+** Returns the cached response for path, provided it still describes the file
+** the open file cache resolved.
+*/
+const CachedContent *ContentCache::find(const std::string &path,
+	const std::string &variant, const OpenFile &file)
+{
+	Index::iterator it;
+	CachedContent *entry;
+
+	it = index_.find(key(path, variant));
+	if (it == index_.end())
+		return (NULL);
+	entry = it->second;
+	if (entry->inode != file.inode || entry->size != file.size
+		|| entry->mtime != file.mtime)
+	{
+		drop(it);
+		return (NULL);
+	}
+	lru_.splice(lru_.begin(), lru_, entry->lru);
+	return (entry);
+}
+
+/*
+** Reads a small file into memory and serializes its response header for both
+** connection types. Returns NULL, leaving the caller to send the file from
+** disk, if the file does not fit or its directory cannot be watched.
+*/
+const CachedContent *ContentCache::insert(const std::string &path,
+	const std::string &variant, const OpenFile &file, HttpResponse &header)
+{
+	CachedContent *entry;
+	std::string body;
+	std::string dir;
+	size_t last_slash;
+	ssize_t got;
+	size_t cost;
+
+	if (!enabled() || file.fd < 0 || static_cast<size_t>(file.size) > max_entry_)
+		return (NULL);
+	last_slash = path.find_last_of('/');
+	dir = last_slash == std::string::npos ? "." : path.substr(0, last_slash);
+	if (!watch(dir))
+		return (NULL);
+	body.resize(file.size);
+	got = 0;
+	while (static_cast<size_t>(got) < body.size())
+	{
+		ssize_t n = pread(file.fd, &body[got], body.size() - got, got);
+		if (n <= 0)
+			return (NULL);
+		got += n;
+	}
+	entry = new CachedContent();
+	entry->key = key(path, variant);
+	header.setConnectionType("close");
+	entry->header[0] = SharedBuffer::create(headerBlock(header));
+	header.setConnectionType("keep-alive");
+	entry->header[1] = SharedBuffer::create(headerBlock(header));
+	entry->body = SharedBuffer::create(body);
+	entry->inode = file.inode;
+	entry->size = file.size;
+	entry->mtime = file.mtime;
+	cost = entry->key.size() + entry->header[0]->size() + entry->header[1]->size()
+		+ entry->body->size();
+	entry->cost = cost;
+	if (cost > max_total_)
+	{
+		entry->header[0]->release();
+		entry->header[1]->release();
+		entry->body->release();
+		delete entry;
+		return (NULL);
+	}
+	if (index_.find(entry->key) != index_.end())
+		drop(index_.find(entry->key));
+	while (total_ + cost > max_total_)
+		drop(index_.find(lru_.back()->key));
+	lru_.push_front(entry);
+	entry->lru = lru_.begin();
+	index_[entry->key] = entry;
+	total_ += cost;
+	return (entry);
+}
+
+/*
+** Drains the inotify queue. A change to a name drops that entry; losing a
+** watched directory drops everything under it, and an overflowed queue drops
+** the whole cache. The same paths are dropped from the open file cache, so
+** the next miss reopens the file instead of reusing a stale fd and stat.
+*/
+void ContentCache::handleEvents(OpenFileCache &files)
+{
+#ifdef __linux__
+	char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+	const struct inotify_event *event;
+	std::map<int, std::string>::iterator watch;
+	ssize_t got;
+
+	while ((got = read(notify_fd_, buffer, sizeof(buffer))) > 0)
+	{
+		for (char *ptr = buffer; ptr < buffer + got;
+			 ptr += sizeof(struct inotify_event) + event->len)
+		{
+			event = reinterpret_cast<const struct inotify_event *>(ptr);
+			if (event->mask & IN_Q_OVERFLOW)
+			{
+				clear();
+				files.invalidatePrefix("");
+				continue ;
+			}
+			watch = watches_.find(event->wd);
+			if (watch == watches_.end())
+				continue ;
+			if (event->mask & (IN_IGNORED | IN_DELETE_SELF | IN_MOVE_SELF))
+			{
+				files.invalidatePrefix(watch->second + "/");
+				dropDirectory(event->wd);
+			}
+			else if (event->len > 0)
+			{
+				invalidate(watch->second + "/" + event->name);
+				files.invalidate(watch->second + "/" + event->name);
+			}
+		}
+	}
+	if (got < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+		perror("inotify read");
+#else
+	(void)files;
+#endif
+}
+
+void ContentCache::invalidate(const std::string &path)
+{
+	std::string prefix;
+	Index::iterator it;
+
+	prefix = key(path, "");
+	it = index_.lower_bound(prefix);
+	while (it != index_.end() && it->first.compare(0, prefix.size(), prefix) == 0)
+		drop(it++);
+}
+
+/*
+** The serialized header without Date and without its closing blank line,
+** so per-request headers can still be appended after it.
+*/
+std::string ContentCache::headerBlock(const HttpResponse &header)
+{
+	std::string block;
+
+	header.serializeHeader(block, false);
+	block.resize(block.size() - 2);
+	return (block);
+}
+
+bool ContentCache::watch(const std::string &dir)
+{
+#ifdef __linux__
+	int wd;
+
+	if (watched_dirs_.find(dir) != watched_dirs_.end())
+		return (true);
+	wd = inotify_add_watch(notify_fd_, dir.c_str(), WATCH_MASK | IN_ONLYDIR);
+	if (wd < 0)
+		return (false);
+	watches_[wd] = dir;
+	watched_dirs_[dir] = wd;
+	return (true);
+#else
+	(void)dir;
+	return (false);
+#endif
+}
+
+/*
+** Forgets a watched directory and every entry beneath it. The kernel drops
+** the watch itself when the directory goes away; otherwise it is removed here
+** so the next insert re-adds it for the new directory under that name.
+*/
+void ContentCache::dropDirectory(int wd)
+{
+	std::map<int, std::string>::iterator watch;
+	std::string prefix;
+	Index::iterator it;
+
+	watch = watches_.find(wd);
+	if (watch == watches_.end())
+		return ;
+	prefix = watch->second + "/";
+	it = index_.lower_bound(prefix);
+	while (it != index_.end() && it->first.compare(0, prefix.size(), prefix) == 0)
+		drop(it++);
+	watched_dirs_.erase(watch->second);
+	watches_.erase(watch);
+#ifdef __linux__
+	inotify_rm_watch(notify_fd_, wd);
+#endif
+}
+
+void ContentCache::drop(Index::iterator it)
+{
+	CachedContent *entry;
+
+	entry = it->second;
+	lru_.erase(entry->lru);
+	index_.erase(it);
+	total_ -= entry->cost;
+	entry->header[0]->release();
+	entry->header[1]->release();
+	entry->body->release();
+	delete entry;
+}
+
+void ContentCache::clear()
+{
+	while (!index_.empty())
+		drop(index_.begin());
+}
@@ -0,0 +1,646 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   DirectoryListing.cpp                               :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: ewiese-m <ewiese-m@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/08/31 11:06:40 by ewiese-m          #+#    #+#             */
+/*   Updated: 2025/08/31 11:06:40 by ewiese-m         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "../inc/DirectoryListing.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+namespace
+{
+	const char HEX_DIGITS[] = "0123456789ABCDEF";
+	const size_t MAX_COUNT = 1000000000;
+
+	struct NameOrder
+	{
+		const std::string *names;
+		NameOrder(const std::string &arena) : names(&arena)
+		{
+		}
+		bool operator()(const DirectorySnapshot::Entry &a,
+			const DirectorySnapshot::Entry &b) const
+		{
+			int diff;
+
+			diff = std::memcmp(names->data() + a.name, names->data() + b.name,
+				std::min(a.length, b.length));
+			if (diff != 0)
+				return (diff < 0);
+			return (a.length < b.length);
+		}
+	};
+
+	void appendHtml(std::string &out, const char *str, size_t length)
+	{
+		for (size_t i = 0; i < length; i++)
+		{
+			if (str[i] == '&')
+				out += "&amp;";
+			else if (str[i] == '<')
+				out += "&lt;";
+			else if (str[i] == '>')
+				out += "&gt;";
+			else if (str[i] == '"')
+				out += "&quot;";
+			else
+				out += str[i];
+		}
+	}
+
+	void appendHref(std::string &out, const char *str, size_t length)
+	{
+		unsigned char c;
+
+		for (size_t i = 0; i < length; i++)
+		{
+			c = str[i];
+			if (std::isalnum(c) || c == '-' || c == '.' || c == '_' || c == '~')
+			{
+				out += c;
+				continue ;
+			}
+			out += '%';
+			out += HEX_DIGITS[c >> 4];
+			out += HEX_DIGITS[c & 15];
+		}
+	}
+
+	void appendJson(std::string &out, const char *str, size_t length)
+	{
+		unsigned char c;
+
+		for (size_t i = 0; i < length; i++)
+		{
+			c = str[i];
+			if (c == '"' || c == '\\')
+			{
+				out += '\\';
+				out += c;
+			}
+			else if (c < 0x20)
+			{
+				out += "\\u00";
+				out += HEX_DIGITS[c >> 4];
+				out += HEX_DIGITS[c & 15];
+			}
+			else
+				out += c;
+		}
+	}
+
+	/*
+	** Same output as formatFileSize() and formatTime()/formatHttpDate(),
+	** written straight into the page. Neighbouring entries often share an
+	** mtime, so the last formatted one is remembered.
+	*/
+	void appendSize(std::string &out, off_t size)
+	{
+		static const char *const UNITS[] = {"KB", "MB", "GB"};
+		char buffer[32];
+		double scaled;
+		int unit;
+
+		if (size < 1024)
+		{
+			snprintf(buffer, sizeof(buffer), "%lld B", static_cast<long long>(size));
+			out += buffer;
+			return ;
+		}
+		scaled = size / 1024.0;
+		unit = 0;
+		while (unit < 2 && size >= (1024LL << (10 * (unit + 1))))
+		{
+			scaled /= 1024.0;
+			unit++;
+		}
+		snprintf(buffer, sizeof(buffer), "%.1f %s", scaled, UNITS[unit]);
+		out += buffer;
+	}
+
+	void appendTime(std::string &out, DirectorySnapshot::Stamp &stamp,
+		time_t time, bool http)
+	{
+		struct tm parts;
+
+		if (time != stamp.time)
+		{
+			stamp.time = time;
+			if (http)
+			{
+				gmtime_r(&time, &parts);
+				stamp.length = strftime(stamp.text, sizeof(stamp.text),
+					"%a, %d %b %Y %H:%M:%S GMT", &parts);
+			}
+			else
+			{
+				localtime_r(&time, &parts);
+				stamp.length = strftime(stamp.text, sizeof(stamp.text),
+					"%Y-%m-%d %H:%M:%S", &parts);
+			}
+		}
+		out.append(stamp.text, stamp.length);
+	}
+
+	/*
+	** FNV-1a, like NameTable, continued from hash.
+	*/
+	unsigned int mix(unsigned int hash, const void *data, size_t length)
+	{
+		const unsigned char *bytes;
+
+		bytes = static_cast<const unsigned char *>(data);
+		for (size_t i = 0; i < length; i++)
+		{
+			hash ^= bytes[i];
+			hash *= 16777619u;
+		}
+		return (hash);
+	}
+
+	bool parseCount(const char *str, size_t length, size_t *value)
+	{
+		size_t result;
+
+		if (length == 0)
+			return (false);
+		result = 0;
+		for (size_t i = 0; i < length; i++)
+		{
+			if (str[i] < '0' || str[i] > '9')
+				return (false);
+			if (result < MAX_COUNT)
+				result = result * 10 + (str[i] - '0');
+		}
+		*value = result;
+		return (true);
+	}
+}
+
+DirectorySnapshot::DirectorySnapshot() : names_(), entries_(), html_rows_(),
+	digest_(2166136261u), mtime_(0), refs_(1)
+{
+}
+
+DirectorySnapshot::~DirectorySnapshot()
+{
+}
+
+/*
+** Returns NULL when the directory cannot be opened. Dot files are left out,
+** and so are entries that vanish between readdir() and fstatat().
+*/
+DirectorySnapshot *DirectorySnapshot::scan(const std::string &path)
+{
+	DirectorySnapshot *snapshot;
+	struct dirent *ent;
+	struct stat info;
+	Entry entry;
+	DIR *dir;
+	int flags;
+
+	dir = opendir(path.c_str());
+	if (!dir)
+		return (NULL);
+	snapshot = new DirectorySnapshot();
+	if (fstat(dirfd(dir), &info) == 0)
+		snapshot->mtime_ = info.st_mtime;
+	while ((ent = readdir(dir)) != NULL)
+	{
+		if (ent->d_name[0] == '.')
+			continue ;
+		flags = AT_SYMLINK_NOFOLLOW;
+		if (ent->d_type == DT_LNK || ent->d_type == DT_UNKNOWN)
+			flags = 0;
+		if (fstatat(dirfd(dir), ent->d_name, &info, flags) != 0)
+			continue ;
+		entry.name = snapshot->names_.size();
+		entry.length = std::strlen(ent->d_name);
+		entry.is_dir = S_ISDIR(info.st_mode);
+		entry.size = info.st_size;
+		entry.mtime = info.st_mtime;
+		snapshot->names_.append(ent->d_name, entry.length);
+		snapshot->entries_.push_back(entry);
+		if (entry.mtime > snapshot->mtime_)
+			snapshot->mtime_ = entry.mtime;
+	}
+	closedir(dir);
+	std::sort(snapshot->entries_.begin(), snapshot->entries_.end(),
+		NameOrder(snapshot->names_));
+	for (size_t i = 0; i < snapshot->entries_.size(); i++)
+	{
+		entry = snapshot->entries_[i];
+		snapshot->digest_ = mix(snapshot->digest_, &entry.length, sizeof(entry.length));
+		snapshot->digest_ = mix(snapshot->digest_,
+			snapshot->names_.data() + entry.name, entry.length);
+		snapshot->digest_ = mix(snapshot->digest_, &entry.is_dir, sizeof(entry.is_dir));
+		snapshot->digest_ = mix(snapshot->digest_, &entry.size, sizeof(entry.size));
+		snapshot->digest_ = mix(snapshot->digest_, &entry.mtime, sizeof(entry.mtime));
+	}
+	if (snapshot->entries_.size() <= RENDER_LIMIT)
+		snapshot->render(snapshot->html_rows_, 0, snapshot->entries_.size(),
+			false, 0);
+	return (snapshot);
+}
+
+DirectorySnapshot *DirectorySnapshot::retain()
+{
+	refs_++;
+	return (this);
+}
+
+void DirectorySnapshot::release()
+{
+	if (--refs_ == 0)
+		delete this;
+}
+
+size_t DirectorySnapshot::size() const
+{
+	return (entries_.size());
+}
+
+size_t DirectorySnapshot::cost() const
+{
+	return (sizeof(*this) + names_.size() + entries_.size() * sizeof(Entry)
+		+ html_rows_.size());
+}
+
+unsigned int DirectorySnapshot::digest() const
+{
+	return (digest_);
+}
+
+time_t DirectorySnapshot::mtime() const
+{
+	return (mtime_);
+}
+
+/*
+** All rows of the HTML listing; only filled for directories of at most
+** RENDER_LIMIT entries.
+*/
+const std::string &DirectorySnapshot::htmlRows() const
+{
+	return (html_rows_);
+}
+
+/*
+** Appends the rows for entries [first, last). JSON objects are separated by
+** commas, so start gives the first entry of the whole array.
+*/
+void DirectorySnapshot::render(std::string &out, size_t first, size_t last,
+	bool json, size_t start) const
+{
+	Stamp stamp;
+
+	stamp.time = -1;
+	stamp.length = 0;
+	for (size_t i = first; i < last; i++)
+	{
+		if (!json)
+		{
+			renderHtml(out, entries_[i], stamp);
+			continue ;
+		}
+		if (i > start)
+			out += ',';
+		out += '\n';
+		renderJson(out, entries_[i], stamp);
+	}
+}
+
+void DirectorySnapshot::renderHtml(std::string &out, const Entry &entry,
+	Stamp &stamp) const
+{
+	const char *name;
+
+	name = names_.data() + entry.name;
+	out += "      <tr>\n        <td><a href=\"";
+	appendHref(out, name, entry.length);
+	out += entry.is_dir ? "/\" class=\"dir\">" : "\">";
+	appendHtml(out, name, entry.length);
+	if (entry.is_dir)
+		out += '/';
+	out += "</a></td>\n        <td class=\"size\">";
+	if (entry.is_dir)
+		out += '-';
+	else
+		appendSize(out, entry.size);
+	out += "</td>\n        <td class=\"date\">";
+	appendTime(out, stamp, entry.mtime, false);
+	out += "</td>\n      </tr>\n";
+}
+
+void DirectorySnapshot::renderJson(std::string &out, const Entry &entry,
+	Stamp &stamp) const
+{
+	char size[32];
+
+	out += "  { \"name\":\"";
+	appendJson(out, names_.data() + entry.name, entry.length);
+	out += entry.is_dir ? "\", \"type\":\"directory\"" : "\", \"type\":\"file\"";
+	out += ", \"mtime\":\"";
+	appendTime(out, stamp, entry.mtime, true);
+	out += '"';
+	if (!entry.is_dir)
+	{
+		snprintf(size, sizeof(size), ", \"size\":%lld",
+			static_cast<long long>(entry.size));
+		out += size;
+	}
+	out += " }";
+}
+
+DirectoryCache::DirectoryCache() : index_(), lru_(), total_(0), valid_(60)
+{
+}
+
+DirectoryCache::~DirectoryCache()
+{
+	while (!index_.empty())
+		drop(index_.begin());
+}
+
+void DirectoryCache::configure(time_t valid)
+{
+	valid_ = valid;
+}
+
+/*
+** The returned snapshot belongs to the cache and stays valid until the next
+** call; retain it to keep it longer. Returns NULL if the directory cannot be
+** read.
+*/
+DirectorySnapshot *DirectoryCache::get(const std::string &path, time_t now)
+{
+	DirectorySnapshot *snapshot;
+	Index::iterator it;
+	struct stat info;
+	Slot slot;
+	Key key;
+
+	if (stat(path.c_str(), &info) != 0)
+		return (NULL);
+	key = Key(info.st_dev, info.st_ino);
+	it = index_.find(key);
+	if (it != index_.end())
+	{
+		if (it->second.mtime == info.st_mtime && it->second.scanned > it->second.mtime
+			&& now - it->second.scanned < valid_)
+		{
+			lru_.splice(lru_.begin(), lru_, it->second.lru);
+			return (it->second.snapshot);
+		}
+		drop(it);
+	}
+	snapshot = DirectorySnapshot::scan(path);
+	if (!snapshot)
+		return (NULL);
+	lru_.push_front(key);
+	slot.snapshot = snapshot;
+	slot.mtime = info.st_mtime;
+	slot.scanned = now;
+	slot.cost = snapshot->cost();
+	slot.lru = lru_.begin();
+	index_[key] = slot;
+	total_ += slot.cost;
+	while (total_ > MAX_TOTAL && lru_.size() > 1)
+		drop(index_.find(lru_.back()));
+	return (snapshot);
+}
+
+void DirectoryCache::drop(Index::iterator it)
+{
+	total_ -= it->second.cost;
+	lru_.erase(it->second.lru);
+	it->second.snapshot->release();
+	index_.erase(it);
+}
+
+DirectoryListing::DirectoryListing() : dir_(NULL), start_(0), next_(0),
+	end_(0), json_(false), chunked_(false), compressor_(NULL), head_(),
+	tail_()
+{
+}
+
+DirectoryListing::~DirectoryListing()
+{
+	clear();
+}
+
+/*
+** Takes over head (the page header, already rendered) and the compressor, if
+** any, and keeps a reference on dir until the last entry has been queued.
+*/
+void DirectoryListing::start(DirectorySnapshot *dir, size_t first,
+	size_t last, bool json, bool chunked, Compressor *compressor,
+	std::string &head, const std::string &tail)
+{
+	clear();
+	dir_ = dir->retain();
+	start_ = first;
+	next_ = first;
+	end_ = last;
+	json_ = json;
+	chunked_ = chunked;
+	compressor_ = compressor;
+	head_.swap(head);
+	tail_ = tail;
+}
+
+bool DirectoryListing::active() const
+{
+	return (dir_ != NULL);
+}
+
+/*
+** Queues the next batch of entries, preceded by the page header on the first
+** call and followed by the page trailer (and the last chunk) on the final one.
+** A batch may compress to nothing yet; deflate hands it out later. Returns
+** false if compression failed, in which case the response cannot be
+** completed and the connection has to be dropped.
+*/
+bool DirectoryListing::pump(OutputQueue &output)
+{
+	std::string chunk;
+	std::string packed;
+	char size[24];
+	size_t stop;
+
+	chunk.swap(head_);
+	stop = std::min(next_ + BATCH, end_);
+	dir_->render(chunk, next_, stop, json_, start_);
+	next_ = stop;
+	if (next_ == end_)
+		chunk += tail_;
+	if (compressor_)
+	{
+		if (!compressor_->update(chunk.data(), chunk.size(), packed)
+			|| (next_ == end_ && !compressor_->finish(packed)))
+		{
+			clear();
+			return (false);
+		}
+		chunk.swap(packed);
+	}
+	if (chunked_ && !chunk.empty())
+	{
+		snprintf(size, sizeof(size), "%lx\r\n",
+			static_cast<unsigned long>(chunk.size()));
+		output.append(size, std::strlen(size));
+		chunk += "\r\n";
+	}
+	output.appendOwned(chunk);
+	if (next_ < end_)
+		return (true);
+	if (chunked_)
+		output.append("0\r\n\r\n", 5);
+	clear();
+	return (true);
+}
+
+void DirectoryListing::clear()
+{
+	if (dir_)
+		dir_->release();
+	dir_ = NULL;
+	delete compressor_;
+	compressor_ = NULL;
+	head_.clear();
+	tail_.clear();
+}
+
+/*
+** Reads offset= and limit= from the query string into the entry range
+** [first, last). limit is 0 when the listing is not paginated; malformed
+** values are ignored.
+*/
+void DirectoryListing::parsePage(const StringRef &query, size_t total,
+	size_t *first, size_t *last, size_t *limit)
+{
+	size_t offset;
+	size_t pos;
+	size_t end;
+
+	offset = 0;
+	*limit = 0;
+	pos = 0;
+	while (pos < query.length)
+	{
+		end = pos;
+		while (end < query.length && query.data[end] != '&')
+			end++;
+		if (end - pos > 7 && std::memcmp(query.data + pos, "offset=", 7) == 0)
+			parseCount(query.data + pos + 7, end - pos - 7, &offset);
+		else if (end - pos > 6 && std::memcmp(query.data + pos, "limit=", 6) == 0)
+			parseCount(query.data + pos + 6, end - pos - 6, limit);
+		pos = end + 1;
+	}
+	*first = std::min(offset, total);
+	*last = total;
+	if (*limit != 0 && *limit < total - *first)
+		*last = *first + *limit;
+}
+
+void DirectoryListing::renderHead(std::string &out, const std::string &uri,
+	bool json)
+{
+	if (json)
+	{
+		out += '[';
+		return ;
+	}
+	out += "<!DOCTYPE html>\n<html>\n<head>\n  <title>Index of ";
+	appendHtml(out, uri.data(), uri.size());
+	out += "</title>\n"
+		"  <style>\n"
+		"    body { font-family: monospace; margin: 20px; }\n"
+		"    h1 { font-size: 24px; }\n"
+		"    table { border-collapse: collapse; width: 100%; }\n"
+		"    th, td { padding: 8px 15px; text-align: left; }\n"
+		"    th { background-color: #f0f0f0; border-bottom: 2px solid #ddd; }\n"
+		"    tr:hover { background-color: #f5f5f5; }\n"
+		"    a { text-decoration: none; color: #0066cc; }\n"
+		"    a:hover { text-decoration: underline; }\n"
+		"    .dir { font-weight: bold; }\n"
+		"    .size { text-align: right; font-family: monospace; }\n"
+		"    .date { font-family: monospace; }\n"
+		"  </style>\n"
+		"</head>\n"
+		"<body>\n"
+		"  <h1>Index of ";
+	appendHtml(out, uri.data(), uri.size());
+	out += "</h1>\n"
+		"  <hr>\n"
+		"  <table>\n"
+		"    <thead>\n"
+		"      <tr>\n"
+		"        <th>Name</th>\n"
+		"        <th>Size</th>\n"
+		"        <th>Last Modified</th>\n"
+		"      </tr>\n"
+		"    </thead>\n"
+		"    <tbody>\n";
+	if (uri != "/")
+		out += "      <tr>\n"
+			"        <td><a href=\"../\" class=\"dir\">../</a></td>\n"
+			"        <td class=\"size\">-</td>\n"
+			"        <td class=\"date\">-</td>\n"
+			"      </tr>\n";
+}
+
+/*
+** A paginated HTML page links to its neighbours with the same limit.
+*/
+void DirectoryListing::renderTail(std::string &out, bool json, size_t first,
+	size_t limit, size_t total)
+{
+	char link[96];
+
+	if (json)
+	{
+		out += "\n]\n";
+		return ;
+	}
+	out += "    </tbody>\n  </table>\n";
+	if (limit != 0 && (first > 0 || first + limit < total))
+	{
+		out += "  <p>";
+		if (first > 0)
+		{
+			snprintf(link, sizeof(link),
+				"<a href=\"?offset=%lu&amp;limit=%lu\">&laquo; Previous</a>",
+				static_cast<unsigned long>(first > limit ? first - limit : 0),
+				static_cast<unsigned long>(limit));
+			out += link;
+		}
+		if (first + limit < total)
+		{
+			snprintf(link, sizeof(link),
+				"%s<a href=\"?offset=%lu&amp;limit=%lu\">Next &raquo;</a>",
+				first > 0 ? " " : "",
+				static_cast<unsigned long>(first + limit),
+				static_cast<unsigned long>(limit));
+			out += link;
+		}
+		out += "</p>\n";
+	}
+	out += "  <hr>\n"
+		"  <address>webserv/1.0 Server</address>\n"
+		"</body>\n"
+		"</html>\n";
+}
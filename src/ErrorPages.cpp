@@ -0,0 +1,126 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   ErrorPages.cpp                                     :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: ewiese-m <ewiese-m@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/08/30 10:41:12 by ewiese-m          #+#    #+#             */
+/*   Updated: 2025/08/30 10:41:12 by ewiese-m         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "../inc/ErrorPages.hpp"
+#include "../inc/utils.hpp"
+
+namespace
+{
+	const int MIN_ERROR = 400;
+	const int MAX_ERROR = 599;
+}
+
+ErrorPages::ErrorPages() : builtin_(), custom_()
+{
+}
+
+ErrorPages::~ErrorPages()
+{
+	clear();
+}
+
+void ErrorPages::build(const std::vector<ServerConfig> &servers)
+{
+	HttpResponse generated;
+	StringRef reason;
+	ErrorPage none;
+
+	clear();
+	none.header[0] = NULL;
+	none.header[1] = NULL;
+	none.body = NULL;
+	none.custom = false;
+	builtin_.assign(MAX_ERROR - MIN_ERROR + 1, none);
+	for (int code = MIN_ERROR; code <= MAX_ERROR; code++)
+	{
+		reason = HttpResponse::reasonPhrase(code);
+		if (reason.empty())
+			continue ;
+		generated.setError(code, reason.str());
+		builtin_[code - MIN_ERROR] = make(code, generated.getBody(), false);
+	}
+	custom_.resize(servers.size());
+	for (size_t i = 0; i < servers.size(); i++)
+	{
+		for (std::map<int, std::string>::const_iterator it
+			= servers[i]._error_pages.begin(); it != servers[i]._error_pages.end(); ++it)
+		{
+			std::string body = readFile(it->second);
+
+			if (!body.empty())
+				custom_[i][it->first] = make(it->first, body, true);
+		}
+	}
+}
+
+const ErrorPage *ErrorPages::find(size_t server, int code) const
+{
+	PageMap::const_iterator it;
+
+	if (server < custom_.size())
+	{
+		it = custom_[server].find(code);
+		if (it != custom_[server].end())
+			return (&it->second);
+	}
+	if (code < MIN_ERROR || code > MAX_ERROR || !builtin_[code - MIN_ERROR].body)
+		return (NULL);
+	return (&builtin_[code - MIN_ERROR]);
+}
+
+void ErrorPages::clear()
+{
+	for (size_t i = 0; i < builtin_.size(); i++)
+	{
+		if (builtin_[i].body)
+			drop(builtin_[i]);
+	}
+	builtin_.clear();
+	for (size_t i = 0; i < custom_.size(); i++)
+	{
+		for (PageMap::iterator it = custom_[i].begin(); it != custom_[i].end(); ++it)
+			drop(it->second);
+	}
+	custom_.clear();
+}
+
+ErrorPage ErrorPages::make(int code, const std::string &body, bool custom)
+{
+	HttpResponse header;
+	ErrorPage page;
+
+	header.setStatusCode(code);
+	header.setBody(body);
+	header.setConnectionType("close");
+	page.header[0] = SharedBuffer::create(headerBlock(header));
+	header.setConnectionType("keep-alive");
+	page.header[1] = SharedBuffer::create(headerBlock(header));
+	page.body = SharedBuffer::create(body);
+	page.custom = custom;
+	return (page);
+}
+
+void ErrorPages::drop(ErrorPage &page)
+{
+	page.header[0]->release();
+	page.header[1]->release();
+	page.body->release();
+}
+
+std::string ErrorPages::headerBlock(const HttpResponse &header)
+{
+	std::string block;
+
+	header.serializeHeader(block, false);
+	block.resize(block.size() - 2);
+	return (block);
+}
@@ -11,231 +11,439 @@
 /* ************************************************************************** */
 
 #include "../inc/HttpRequest.hpp"
-#include <sstream>
-#include <algorithm>
-#include <cctype>
+#include "../inc/Scanner.hpp"
+#include <cstring>
 
-HttpRequest::HttpRequest() : method_(""),
-                             uri_(""),
-                             http_version_(""),
-                             headers_(),
-                             body_(""),
-                             is_valid_(false),
-                             body_length_(0) {}
+static const char *const g_methods[HttpRequest::METHOD_COUNT] = {
+    "GET", "POST", "DELETE", "PUT", "HEAD", "OPTIONS"
+};
 
-bool HttpRequest::parse(const std::string &data)
+static const char *const g_known_headers[] = {
+    "host", "connection", "content-length", "content-type", "transfer-encoding",
+    "accept-encoding", "range", "if-range", "if-none-match",
+    "if-modified-since"
+};
+
+static bool isBlank(char c)
 {
-    clear();
+    return c == ' ' || c == '\t';
+}
 
-    if (data.empty())
-    {
-        return false;
-    }
+HttpRequest::HttpRequest() : data_(NULL),
+                             method_(METHOD_GET),
+                             version_(HTTP_1_1),
+                             extra_headers_(),
+                             header_count_(0),
+                             state_(STATE_REQUEST_LINE),
+                             line_start_(0),
+                             scan_pos_(0),
+                             header_end_(0),
+                             body_length_(0),
+                             error_status_(400)
+{
+    reset();
+}
 
-    size_t header_end = data.find("\r\n\r\n");
-    if (header_end == std::string::npos)
-    {
+/*
+** Resumable parser. It is called again every time more bytes land in the
+** connection buffer and picks up where it stopped: each line of the request
+** line and headers is parsed exactly once, as soon as its '\n' arrives, and
+** the body length is known the moment the blank line is seen. The buffer may
+** hold further pipelined requests after this one; getLength() tells how many
+** bytes belong to it.
+*/
+HttpRequest::ParseStatus HttpRequest::parse(const std::string &data)
+{
+    const char *begin = data.data();
+    const char *limit = begin + data.length();
 
-        header_end = data.find("\n\n");
-        if (header_end == std::string::npos)
+    data_ = &data;
+    while (state_ == STATE_REQUEST_LINE || state_ == STATE_HEADERS)
+    {
+        const char *eol = scanAny(begin + scan_pos_, limit, '\n', '\n');
+        if (eol == limit)
         {
-            return false;
+            scan_pos_ = data.length();
+            return PARSE_INCOMPLETE;
         }
-    }
 
-    std::string header_section = data.substr(0, header_end);
-    std::string body_section = "";
+        size_t start = line_start_;
+        size_t end = eol - begin;
+        if (end > start && data[end - 1] == '\r')
+        {
+            end--;
+        }
+        line_start_ = (eol - begin) + 1;
+        scan_pos_ = line_start_;
 
-    if (header_end + 4 < data.length())
-    {
-        body_section = data.substr(header_end + 4);
+        if (state_ == STATE_REQUEST_LINE)
+        {
+            if (start == end)
+            {
+                continue;
+            }
+            if (!parseRequestLine(start, end))
+            {
+                state_ = STATE_ERROR;
+                return PARSE_ERROR;
+            }
+            state_ = STATE_HEADERS;
+        }
+        else if (start == end)
+        {
+            header_end_ = line_start_;
+            state_ = (body_length_ > 0) ? STATE_BODY : STATE_COMPLETE;
+        }
+        else if (!parseHeaderLine(start, end))
+        {
+            state_ = STATE_ERROR;
+            return PARSE_ERROR;
+        }
     }
-    else if (header_end + 2 < data.length())
+
+    if (state_ == STATE_BODY)
     {
-        body_section = data.substr(header_end + 2);
+        if (data.length() - header_end_ < body_length_)
+        {
+            return PARSE_INCOMPLETE;
+        }
+        body_.offset = header_end_;
+        body_.length = body_length_;
+        state_ = STATE_COMPLETE;
     }
 
-    size_t first_line_end = header_section.find("\r\n");
-    if (first_line_end == std::string::npos)
+    return (state_ == STATE_COMPLETE) ? PARSE_COMPLETE : PARSE_ERROR;
+}
+
+/*
+** METHOD SP URI SP VERSION. The method and version are turned into enums
+** here, so nothing past the parser compares them as strings.
+*/
+bool HttpRequest::parseRequestLine(size_t start, size_t end)
+{
+    const char *line = data_->data();
+    Slice parts[3];
+    size_t pos = start;
+
+    for (int i = 0; i < 3; i++)
     {
-        first_line_end = header_section.find("\n");
+        while (pos < end && isBlank(line[pos]))
+            pos++;
+        parts[i].offset = pos;
+        pos = scanAny(line + pos, line + end, ' ', '\t') - line;
+        parts[i].length = pos - parts[i].offset;
+        if (parts[i].length == 0)
+        {
+            return false;
+        }
     }
 
-    if (first_line_end == std::string::npos)
+    Method method = methodFromName(ref(parts[0]));
+    if (method == METHOD_COUNT)
     {
         return false;
     }
+    method_ = method;
 
-    std::string request_line = header_section.substr(0, first_line_end);
-    if (!parseRequestLine(request_line))
+    uri_ = parts[1];
+    http_version_ = parts[2];
+    const char *version = line + http_version_.offset;
+    if (http_version_.length != 8 || std::memcmp(version, "HTTP/1.", 7) != 0)
     {
         return false;
     }
-
-    std::string headers_only = header_section.substr(first_line_end);
-    if (!headers_only.empty())
+    if (version[7] == '1')
     {
-        if (headers_only[0] == '\r')
-            headers_only = headers_only.substr(2);
-        else if (headers_only[0] == '\n')
-            headers_only = headers_only.substr(1);
-
-        if (!parseHeaders(headers_only))
-        {
-            return false;
-        }
+        version_ = HTTP_1_1;
     }
-
-    if (!body_section.empty())
+    else if (version[7] == '0')
     {
-        parseBody(body_section);
+        version_ = HTTP_1_0;
+    }
+    else
+    {
+        return false;
     }
 
-    is_valid_ = true;
     return true;
 }
 
-bool HttpRequest::parseRequestLine(const std::string &line)
+/*
+** Case-insensitive, as the parser has always been. The length picks the one
+** or two candidates to compare against; METHOD_COUNT means unknown.
+*/
+HttpRequest::Method HttpRequest::methodFromName(const StringRef &name)
 {
-    std::istringstream iss(line);
+    Method candidate;
 
-    if (!(iss >> method_ >> uri_ >> http_version_))
+    switch (name.length)
     {
-        return false;
+    case 3:
+        candidate = (name.data[0] == 'P' || name.data[0] == 'p') ? METHOD_PUT : METHOD_GET;
+        break;
+    case 4:
+        candidate = (name.data[0] == 'H' || name.data[0] == 'h') ? METHOD_HEAD : METHOD_POST;
+        break;
+    case 6:
+        candidate = METHOD_DELETE;
+        break;
+    case 7:
+        candidate = METHOD_OPTIONS;
+        break;
+    default:
+        return METHOD_COUNT;
     }
-
-    std::transform(method_.begin(), method_.end(), method_.begin(), ::toupper);
-
-    if (method_ != "GET" && method_ != "POST" && method_ != "DELETE" &&
-        method_ != "PUT" && method_ != "HEAD" && method_ != "OPTIONS")
+    if (!name.equalsIgnoreCase(g_methods[candidate]))
     {
-        return false;
+        return METHOD_COUNT;
     }
-
-    if (http_version_ != "HTTP/1.0" && http_version_ != "HTTP/1.1")
-    {
-        return false;
-    }
-
-    return true;
+    return candidate;
 }
 
-bool HttpRequest::parseHeaders(const std::string &headers)
+const char *HttpRequest::methodName(Method method)
 {
-    std::istringstream stream(headers);
-    std::string line;
+    return g_methods[method];
+}
 
-    while (std::getline(stream, line))
+/*
+** name ":" OWS value OWS. Lines without a colon or with an empty name or value are ignored. Well-known
+** headers are recorded in known_ so lookups for them are a single index.
+**
+** The body must be framed unambiguously, or its bytes would be read as the
+** next pipelined request. So an empty Content-Length, or one that disagrees
+** with an earlier one, is rejected, and so is any Transfer-Encoding, since
+** no transfer coding is decoded.
+*/
+bool HttpRequest::parseHeaderLine(size_t start, size_t end)
+{
+    const char *line = data_->data();
+    const char *colon = scanAny(line + start, line + end, ':', ':');
+    if (colon == line + end)
     {
+        return true;
+    }
 
-        if (!line.empty() && line[line.length() - 1] == '\r')
-        {
-            line = line.substr(0, line.length() - 1);
-        }
+    HeaderField field;
+    size_t name_start = start;
+    size_t name_end = colon - line;
+    size_t value_start = name_end + 1;
+    size_t value_end = end;
+
+    while (name_start < name_end && isBlank(line[name_start]))
+        name_start++;
+    while (name_end > name_start && isBlank(line[name_end - 1]))
+        name_end--;
+    while (value_start < value_end && isBlank(line[value_start]))
+        value_start++;
+    while (value_end > value_start && isBlank(line[value_end - 1]))
+        value_end--;
+    if (name_start == name_end)
+    {
+        return true;
+    }
 
-        if (line.empty())
+    StringRef name(line + name_start, name_end - name_start);
+    int known = -1;
+    for (int id = 0; id < HEADER_KNOWN_COUNT; id++)
+    {
+        if (name.equalsIgnoreCase(g_known_headers[id]))
         {
+            known = id;
             break;
         }
+    }
 
-        size_t colon_pos = line.find(':');
-        if (colon_pos == std::string::npos)
+    if (known == HEADER_TRANSFER_ENCODING)
+    {
+        error_status_ = 501;
+        return false;
+    }
+    if (value_start == value_end)
+    {
+        return known != HEADER_CONTENT_LENGTH;
+    }
+    if (known == HEADER_CONTENT_LENGTH)
+    {
+        size_t length = 0;
+        for (size_t i = value_start; i < value_end; i++)
         {
-            continue;
+            if (line[i] < '0' || line[i] > '9' || length > (static_cast<size_t>(-1) - 9) / 10)
+            {
+                return false;
+            }
+            length = length * 10 + (line[i] - '0');
         }
-
-        std::string name = toLowerCase(trim(line.substr(0, colon_pos)));
-        std::string value = trim(line.substr(colon_pos + 1));
-
-        if (!name.empty() && !value.empty())
+        if (known_[HEADER_CONTENT_LENGTH] >= 0 && length != body_length_)
         {
-            headers_[name] = value;
+            return false;
         }
+        body_length_ = length;
     }
 
-    std::map<std::string, std::string>::const_iterator it = headers_.find("content-length");
-    if (it != headers_.end())
+    field.name.offset = name_start;
+    field.name.length = name_end - name_start;
+    field.value.offset = value_start;
+    field.value.length = value_end - value_start;
+    if (header_count_ < INLINE_HEADERS)
+    {
+        headers_[header_count_] = field;
+    }
+    else
+    {
+        extra_headers_.push_back(field);
+    }
+    if (known >= 0)
     {
-        std::istringstream length_stream(it->second);
-        length_stream >> body_length_;
+        known_[known] = header_count_;
     }
+    header_count_++;
 
     return true;
 }
 
-void HttpRequest::parseBody(const std::string &body)
+void HttpRequest::reset()
 {
-    body_ = body;
-
-    if (body_length_ > 0 && body_.length() > body_length_)
+    data_ = NULL;
+    method_ = METHOD_GET;
+    version_ = HTTP_1_1;
+    uri_.offset = 0;
+    uri_.length = 0;
+    http_version_ = uri_;
+    body_ = uri_;
+    extra_headers_.clear();
+    header_count_ = 0;
+    for (int id = 0; id < HEADER_KNOWN_COUNT; id++)
     {
-        body_ = body_.substr(0, body_length_);
+        known_[id] = -1;
     }
+    state_ = STATE_REQUEST_LINE;
+    line_start_ = 0;
+    scan_pos_ = 0;
+    header_end_ = 0;
+    body_length_ = 0;
+    error_status_ = 400;
 }
 
-void HttpRequest::clear()
+/*
+** Status to answer a PARSE_ERROR with: 501 for a Transfer-Encoding, whose
+** body cannot be framed, and 400 for anything else. The connection is
+** closed either way.
+*/
+int HttpRequest::getErrorStatus() const
 {
-    method_ = "";
-    uri_ = "";
-    http_version_ = "";
-    headers_.clear();
-    body_ = "";
-    is_valid_ = false;
-    body_length_ = 0;
+    return error_status_;
 }
 
-const std::string &HttpRequest::getMethod() const
+/*
+** Size of the request line and header section as far as parse() has looked
+** at it: all of it once complete, otherwise every byte scanned while still
+** looking for the blank line. Bytes that parse() has not seen yet, such as a
+** pipelined request queued behind a paused one, do not count.
+*/
+size_t HttpRequest::getHeaderBytes() const
 {
-    return method_;
+    if (headersComplete())
+    {
+        return header_end_;
+    }
+    return scan_pos_;
 }
 
-const std::string &HttpRequest::getUri() const
+bool HttpRequest::headersComplete() const
 {
-    return uri_;
+    return state_ == STATE_BODY || state_ == STATE_COMPLETE;
 }
 
-const std::string &HttpRequest::getHttpVersion() const
+size_t HttpRequest::getContentLength() const
 {
-    return http_version_;
+    return body_length_;
 }
 
-const std::string &HttpRequest::getBody() const
+size_t HttpRequest::getLength() const
 {
-    return body_;
+    return header_end_ + body_length_;
 }
 
-std::string HttpRequest::getHeader(const std::string &name) const
+StringRef HttpRequest::ref(const Slice &slice) const
 {
-    std::string lower_name = toLowerCase(name);
-    std::map<std::string, std::string>::const_iterator it = headers_.find(lower_name);
+    if (data_ == NULL || slice.length == 0)
+    {
+        return StringRef();
+    }
+    return StringRef(data_->data() + slice.offset, slice.length);
+}
 
-    if (it != headers_.end())
+const HttpRequest::HeaderField &HttpRequest::header(size_t index) const
+{
+    if (index < INLINE_HEADERS)
     {
-        return it->second;
+        return headers_[index];
     }
-    return "";
+    return extra_headers_[index - INLINE_HEADERS];
 }
 
-const std::map<std::string, std::string> &HttpRequest::getHeaders() const
+StringRef HttpRequest::getMethod() const
 {
-    return headers_;
+    return StringRef(g_methods[method_]);
 }
 
-std::string HttpRequest::trim(const std::string &str)
+HttpRequest::Method HttpRequest::getMethodId() const
 {
-    size_t first = str.find_first_not_of(" \t\r\n");
-    if (first == std::string::npos)
+    return method_;
+}
+
+StringRef HttpRequest::getUri() const
+{
+    return ref(uri_);
+}
+
+StringRef HttpRequest::getHttpVersion() const
+{
+    return ref(http_version_);
+}
+
+HttpRequest::Version HttpRequest::getVersion() const
+{
+    return version_;
+}
+
+StringRef HttpRequest::getBody() const
+{
+    return ref(body_);
+}
+
+StringRef HttpRequest::getHeader(HeaderId id) const
+{
+    if (known_[id] < 0)
     {
-        return "";
+        return StringRef();
     }
+    return ref(header(known_[id]).value);
+}
 
-    size_t last = str.find_last_not_of(" \t\r\n");
-    return str.substr(first, (last - first + 1));
+StringRef HttpRequest::getHeader(const char *name) const
+{
+    for (size_t i = header_count_; i > 0; i--)
+    {
+        if (ref(header(i - 1).name).equalsIgnoreCase(name))
+        {
+            return ref(header(i - 1).value);
+        }
+    }
+    return StringRef();
+}
+
+size_t HttpRequest::getHeaderCount() const
+{
+    return header_count_;
+}
+
+StringRef HttpRequest::getHeaderName(size_t index) const
+{
+    return ref(header(index).name);
 }
 
-std::string HttpRequest::toLowerCase(const std::string &str)
+StringRef HttpRequest::getHeaderValue(size_t index) const
 {
-    std::string result = str;
-    std::transform(result.begin(), result.end(), result.begin(), ::tolower);
-    return result;
+    return ref(header(index).value);
 }
@@ -11,107 +11,168 @@
 /* ************************************************************************** */
 
 #include "../inc/HttpResponse.hpp"
+#include "../inc/Clock.hpp"
+#include <cstdio>
+#include <cstring>
 #include <sstream>
-#include <algorithm>
-#include <cctype>
 
-const std::map<int, std::string> HttpResponse::status_messages_ = HttpResponse::initStatusCodes();
+namespace
+{
+    struct StatusLine
+    {
+        int code;
+        const char *line;
+    };
+
+    const StatusLine g_status_list[] = {
+        {100, "HTTP/1.1 100 Continue\r\n"},
+        {101, "HTTP/1.1 101 Switching Protocols\r\n"},
+        {200, "HTTP/1.1 200 OK\r\n"},
+        {201, "HTTP/1.1 201 Created\r\n"},
+        {202, "HTTP/1.1 202 Accepted\r\n"},
+        {204, "HTTP/1.1 204 No Content\r\n"},
+        {206, "HTTP/1.1 206 Partial Content\r\n"},
+        {301, "HTTP/1.1 301 Moved Permanently\r\n"},
+        {302, "HTTP/1.1 302 Found\r\n"},
+        {303, "HTTP/1.1 303 See Other\r\n"},
+        {304, "HTTP/1.1 304 Not Modified\r\n"},
+        {307, "HTTP/1.1 307 Temporary Redirect\r\n"},
+        {308, "HTTP/1.1 308 Permanent Redirect\r\n"},
+        {400, "HTTP/1.1 400 Bad Request\r\n"},
+        {401, "HTTP/1.1 401 Unauthorized\r\n"},
+        {403, "HTTP/1.1 403 Forbidden\r\n"},
+        {404, "HTTP/1.1 404 Not Found\r\n"},
+        {405, "HTTP/1.1 405 Method Not Allowed\r\n"},
+        {408, "HTTP/1.1 408 Request Timeout\r\n"},
+        {409, "HTTP/1.1 409 Conflict\r\n"},
+        {411, "HTTP/1.1 411 Length Required\r\n"},
+        {413, "HTTP/1.1 413 Payload Too Large\r\n"},
+        {414, "HTTP/1.1 414 URI Too Long\r\n"},
+        {415, "HTTP/1.1 415 Unsupported Media Type\r\n"},
+        {416, "HTTP/1.1 416 Range Not Satisfiable\r\n"},
+        {500, "HTTP/1.1 500 Internal Server Error\r\n"},
+        {501, "HTTP/1.1 501 Not Implemented\r\n"},
+        {502, "HTTP/1.1 502 Bad Gateway\r\n"},
+        {503, "HTTP/1.1 503 Service Unavailable\r\n"},
+        {504, "HTTP/1.1 504 Gateway Timeout\r\n"},
+        {505, "HTTP/1.1 505 HTTP Version Not Supported\r\n"}
+    };
+
+    const int MIN_STATUS = 100;
+    const int MAX_STATUS = 599;
+
+    /*
+    ** Status lines indexed directly by code, built once at startup from the
+    ** list above; the serializer copies the line without any lookup.
+    */
+    struct StatusTable
+    {
+        const char *lines[MAX_STATUS - MIN_STATUS + 1];
+        size_t lengths[MAX_STATUS - MIN_STATUS + 1];
+
+        StatusTable()
+        {
+            std::memset(lines, 0, sizeof(lines));
+            std::memset(lengths, 0, sizeof(lengths));
+            for (size_t i = 0; i < sizeof(g_status_list) / sizeof(g_status_list[0]); i++)
+            {
+                lines[g_status_list[i].code - MIN_STATUS] = g_status_list[i].line;
+                lengths[g_status_list[i].code - MIN_STATUS] = std::strlen(g_status_list[i].line);
+            }
+        }
+    };
+
+    const StatusTable g_status_table;
+
+    const char SERVER_HEADER[] = "server: webserv/1.0\r\n";
+}
 
 HttpResponse::HttpResponse() : status_code_(200),
                                connection_type_("close"),
                                headers_(),
-                               body_("")
+                               body_(""),
+                               close_delimited_(false)
 {
-
-    headers_["server"] = "webserv/1.0";
-    headers_["content-type"] = "text/html";
+    headers_.reserve(8);
+    headers_.push_back(Header("content-type", "text/html"));
 }
 
-std::map<int, std::string> HttpResponse::initStatusCodes()
+void HttpResponse::appendStatusLine(std::string &out, int code)
 {
-    std::map<int, std::string> codes;
-
-    codes[100] = "Continue";
-    codes[101] = "Switching Protocols";
-
-    codes[200] = "OK";
-    codes[201] = "Created";
-    codes[202] = "Accepted";
-    codes[204] = "No Content";
-
-    codes[301] = "Moved Permanently";
-    codes[302] = "Found";
-    codes[303] = "See Other";
-    codes[304] = "Not Modified";
-    codes[307] = "Temporary Redirect";
-    codes[308] = "Permanent Redirect";
-
-    codes[400] = "Bad Request";
-    codes[401] = "Unauthorized";
-    codes[403] = "Forbidden";
-    codes[404] = "Not Found";
-    codes[405] = "Method Not Allowed";
-    codes[408] = "Request Timeout";
-    codes[409] = "Conflict";
-    codes[411] = "Length Required";
-    codes[413] = "Payload Too Large";
-    codes[414] = "URI Too Long";
-    codes[415] = "Unsupported Media Type";
-
-    codes[500] = "Internal Server Error";
-    codes[501] = "Not Implemented";
-    codes[502] = "Bad Gateway";
-    codes[503] = "Service Unavailable";
-    codes[504] = "Gateway Timeout";
-    codes[505] = "HTTP Version Not Supported";
-
-    return codes;
+    if (code >= MIN_STATUS && code <= MAX_STATUS && g_status_table.lines[code - MIN_STATUS])
+    {
+        out.append(g_status_table.lines[code - MIN_STATUS], g_status_table.lengths[code - MIN_STATUS]);
+        return;
+    }
+    std::ostringstream line;
+    line << "HTTP/1.1 " << code << " Unknown\r\n";
+    out += line.str();
 }
 
-std::string HttpResponse::serialize() const
+/*
+** Reason phrase of a known status, pointing into the static status line;
+** empty for codes the table does not list.
+*/
+StringRef HttpResponse::reasonPhrase(int code)
 {
-    std::ostringstream response;
+    static const size_t PREFIX = sizeof("HTTP/1.1 000 ") - 1;
 
-    response << "HTTP/1.1 " << status_code_ << " ";
+    if (code < MIN_STATUS || code > MAX_STATUS || !g_status_table.lines[code - MIN_STATUS])
+        return StringRef();
+    return StringRef(g_status_table.lines[code - MIN_STATUS] + PREFIX,
+                     g_status_table.lengths[code - MIN_STATUS] - PREFIX - 2);
+}
 
-    std::map<int, std::string>::const_iterator it = status_messages_.find(status_code_);
-    if (it != status_messages_.end())
-    {
-        response << it->second;
-    }
-    else
-    {
-        response << "Unknown";
-    }
-    response << "\r\n";
+/*
+** Appends the status line and header block, up to and including the blank
+** line, to out. Content-Length is derived from the body unless set
+** explicitly, the body is chunked or ends with the connection, or the status
+** forbids a body.
+*/
+void HttpResponse::serializeHeader(std::string &out, bool with_date) const
+{
+    char length[24];
+    bool has_length = false;
 
-    for (std::map<std::string, std::string>::const_iterator header_it = headers_.begin();
-         header_it != headers_.end(); ++header_it)
+    appendStatusLine(out, status_code_);
+    for (std::vector<Header>::const_iterator it = headers_.begin(); it != headers_.end(); ++it)
     {
-        response << header_it->first << ": " << header_it->second << "\r\n";
+        out += it->first;
+        out += ": ";
+        out += it->second;
+        out += "\r\n";
+        if (it->first == "content-length" || it->first == "transfer-encoding")
+            has_length = true;
     }
-
-    if (!body_.empty())
+    out.append(SERVER_HEADER, sizeof(SERVER_HEADER) - 1);
+    if (with_date)
+        out += Clock::dateHeader();
+    if (!has_length && !close_delimited_ && status_code_ != 204 && status_code_ != 304)
     {
-        response << "content-length: " << body_.length() << "\r\n";
+        snprintf(length, sizeof(length), "%lu", static_cast<unsigned long>(body_.length()));
+        out += "content-length: ";
+        out += length;
+        out += "\r\n";
     }
+    out += "connection: ";
+    out += connection_type_;
+    out += "\r\n\r\n";
+}
 
-    response << "connection: " << connection_type_ << "\r\n";
-
-    response << "\r\n";
-
-    if (!body_.empty())
-    {
-        response << body_;
-    }
+std::string HttpResponse::serialize() const
+{
+    std::string response;
 
-    return response.str();
+    response.reserve(256 + body_.size());
+    serializeHeader(response);
+    response += body_;
+    return response;
 }
 
 void HttpResponse::setError(int code, const std::string &message)
 {
     status_code_ = code;
-    headers_["content-type"] = "text/html";
+    addHeader("content-type", "text/html");
 
     std::ostringstream error_body;
     error_body << "<!DOCTYPE html>\n";
@@ -130,8 +191,37 @@ void HttpResponse::setError(int code, const std::string &message)
 
 void HttpResponse::addHeader(const std::string &key, const std::string &value)
 {
-    std::string lower_key = toLowerCase(key);
-    headers_[lower_key] = value;
+    for (std::vector<Header>::iterator it = headers_.begin(); it != headers_.end(); ++it)
+    {
+        if (it->first == key)
+        {
+            it->second = value;
+            return;
+        }
+    }
+    headers_.push_back(Header(key, value));
+}
+
+void HttpResponse::removeHeader(const std::string &key)
+{
+    for (std::vector<Header>::iterator it = headers_.begin(); it != headers_.end(); ++it)
+    {
+        if (it->first == key)
+        {
+            headers_.erase(it);
+            return;
+        }
+    }
+}
+
+const std::string *HttpResponse::getHeader(const std::string &key) const
+{
+    for (std::vector<Header>::const_iterator it = headers_.begin(); it != headers_.end(); ++it)
+    {
+        if (it->first == key)
+            return &it->second;
+    }
+    return NULL;
 }
 
 int HttpResponse::getStatusCode() const
@@ -149,7 +239,7 @@ const std::string &HttpResponse::getConnectionType() const
     return connection_type_;
 }
 
-const std::map<std::string, std::string> &HttpResponse::getHeaders() const
+const std::vector<HttpResponse::Header> &HttpResponse::getHeaders() const
 {
     return headers_;
 }
@@ -164,14 +254,21 @@ void HttpResponse::setBody(const std::string &content)
     body_ = content;
 }
 
+void HttpResponse::swapBody(std::string &other)
+{
+    body_.swap(other);
+}
+
 void HttpResponse::setConnectionType(const std::string &type)
 {
     connection_type_ = type;
 }
 
-std::string HttpResponse::toLowerCase(const std::string &str)
+/*
+** For bodies streamed to HTTP/1.0 clients: no Content-Length is sent and
+** the body ends when the connection is closed.
+*/
+void HttpResponse::setCloseDelimited(bool close_delimited)
 {
-    std::string result = str;
-    std::transform(result.begin(), result.end(), result.begin(), ::tolower);
-    return result;
+    close_delimited_ = close_delimited;
 }
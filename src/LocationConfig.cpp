@@ -11,10 +11,16 @@
 /* ************************************************************************** */
 
 #include "../inc/LocationConfig.hpp"
+#include "../inc/HttpRequest.hpp"
 
 LocationConfig::LocationConfig() : _path(""), _root(""), _allowed_methods(),
+                                   _allowed_mask((1u << HttpRequest::METHOD_COUNT) - 1),
                                    _index_file(""), _directory_listing(false), _cgi_path(""),
-                                   _cgi_extension(""), _upload_path(""), _redirect("")
+                                   _cgi_extension(""), _upload_path(""), _redirect(""),
+                                   _static_compressed(false), _compress(false),
+                                   _compress_types(1, "text/html"), _compress_min_length(20),
+                                   _compress_level(1), _expires_mode(EXPIRES_OFF), _expires(0),
+                                   _cache_control(""), _expires_header(""), _cache_control_header("")
 {
 }
 
@@ -24,10 +30,21 @@ LocationConfig::~LocationConfig()
 
 LocationConfig::LocationConfig(const LocationConfig &other) : _path(other._path),
                                                               _root(other._root), _allowed_methods(other._allowed_methods),
+                                                              _allowed_mask(other._allowed_mask),
                                                               _index_file(other._index_file),
                                                               _directory_listing(other._directory_listing), _cgi_path(other._cgi_path),
                                                               _cgi_extension(other._cgi_extension), _upload_path(other._upload_path),
-                                                              _redirect(other._redirect)
+                                                              _redirect(other._redirect),
+                                                              _static_compressed(other._static_compressed),
+                                                              _compress(other._compress),
+                                                              _compress_types(other._compress_types),
+                                                              _compress_min_length(other._compress_min_length),
+                                                              _compress_level(other._compress_level),
+                                                              _expires_mode(other._expires_mode),
+                                                              _expires(other._expires),
+                                                              _cache_control(other._cache_control),
+                                                              _expires_header(other._expires_header),
+                                                              _cache_control_header(other._cache_control_header)
 {
 }
 
@@ -38,12 +55,23 @@ LocationConfig &LocationConfig::operator=(const LocationConfig &other)
         _path = other._path;
         _root = other._root;
         _allowed_methods = other._allowed_methods;
+        _allowed_mask = other._allowed_mask;
         _index_file = other._index_file;
         _directory_listing = other._directory_listing;
         _cgi_path = other._cgi_path;
         _cgi_extension = other._cgi_extension;
         _upload_path = other._upload_path;
         _redirect = other._redirect;
+        _static_compressed = other._static_compressed;
+        _compress = other._compress;
+        _compress_types = other._compress_types;
+        _compress_min_length = other._compress_min_length;
+        _compress_level = other._compress_level;
+        _expires_mode = other._expires_mode;
+        _expires = other._expires;
+        _cache_control = other._cache_control;
+        _expires_header = other._expires_header;
+        _cache_control_header = other._cache_control_header;
     }
     return (*this);
 }
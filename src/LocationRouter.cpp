@@ -0,0 +1,178 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   LocationRouter.cpp                                 :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: ewiese-m <ewiese-m@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/08/28 10:26:13 by ewiese-m          #+#    #+#             */
+/*   Updated: 2025/08/28 10:26:13 by ewiese-m         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "../inc/LocationRouter.hpp"
+#include "../inc/utils.hpp"
+#include <algorithm>
+#include <cstring>
+
+static bool sameExtension(const std::pair<std::string, int> &a,
+	const std::pair<std::string, int> &b)
+{
+	return (a.first == b.first);
+}
+
+LocationRouter::LocationRouter() : nodes_(), extensions_()
+{
+}
+
+/*
+** Rebuilds the trie and the extension table. On duplicate paths the first
+** location keeps the route, as with the old linear scan.
+*/
+void LocationRouter::compile(const std::vector<LocationConfig> &locations)
+{
+	nodes_.clear();
+	extensions_.clear();
+	newNode("", -1);
+	for (size_t i = 0; i < locations.size(); i++)
+	{
+		const std::string &path = locations[i]._path;
+		if (path.empty())
+			continue ;
+		if (path[0] == '.')
+			extensions_.push_back(Extension(path, static_cast<int>(i)));
+		else
+			insert(path, static_cast<int>(i));
+	}
+	std::sort(extensions_.begin(), extensions_.end());
+	extensions_.erase(std::unique(extensions_.begin(), extensions_.end(),
+		sameExtension), extensions_.end());
+}
+
+int LocationRouter::newNode(const std::string &label, int location)
+{
+	Node node;
+
+	node.label = label;
+	node.location = location;
+	nodes_.push_back(node);
+	return (static_cast<int>(nodes_.size() - 1));
+}
+
+/*
+** Walks down while whole edge labels match. A partially matching edge is
+** split at the first differing byte; what is left of the path becomes a
+** new leaf under the split point.
+*/
+void LocationRouter::insert(const std::string &path, int location)
+{
+	size_t node = 0;
+	size_t pos = 0;
+	size_t slot;
+	size_t common;
+	int child;
+	int middle;
+
+	while (pos < path.length())
+	{
+		slot = nodes_[node].keys.find(path[pos]);
+		if (slot == std::string::npos)
+		{
+			child = newNode(path.substr(pos), location);
+			nodes_[node].keys += path[pos];
+			nodes_[node].children.push_back(child);
+			return ;
+		}
+		child = nodes_[node].children[slot];
+		const std::string label = nodes_[child].label;
+		common = 0;
+		while (common < label.length() && pos + common < path.length()
+			&& label[common] == path[pos + common])
+			common++;
+		if (common < label.length())
+		{
+			middle = newNode(label.substr(0, common), -1);
+			nodes_[child].label = label.substr(common);
+			nodes_[middle].keys += label[common];
+			nodes_[middle].children.push_back(child);
+			nodes_[node].children[slot] = middle;
+			child = middle;
+		}
+		node = child;
+		pos += common;
+	}
+	if (nodes_[node].location < 0)
+		nodes_[node].location = location;
+}
+
+int LocationRouter::findExtension(const StringRef &extension) const
+{
+	size_t low = 0;
+	size_t high = extensions_.size();
+	size_t mid;
+	int order;
+
+	while (low < high)
+	{
+		mid = (low + high) / 2;
+		const std::string &key = extensions_[mid].first;
+		order = std::memcmp(key.data(), extension.data,
+			std::min(key.length(), extension.length));
+		if (order == 0 && key.length() != extension.length)
+			order = key.length() < extension.length ? -1 : 1;
+		if (order == 0)
+			return (extensions_[mid].second);
+		if (order < 0)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+	return (-1);
+}
+
+/*
+** Returns an index into the locations the router was compiled from, or -1
+** when the server has none.
+*/
+int LocationRouter::find(const StringRef &uri) const
+{
+	const char *query;
+	size_t length;
+	size_t node = 0;
+	size_t pos = 0;
+	size_t slot;
+	int prefix = -1;
+	int extension;
+
+	if (nodes_.empty())
+		return (-1);
+	query = static_cast<const char *>(std::memchr(uri.data, '?', uri.length));
+	length = query ? static_cast<size_t>(query - uri.data) : uri.length;
+	while (pos < length)
+	{
+		slot = nodes_[node].keys.find(uri.data[pos]);
+		if (slot == std::string::npos)
+			break ;
+		node = nodes_[node].children[slot];
+		const std::string &label = nodes_[node].label;
+		if (length - pos < label.length()
+			|| std::memcmp(uri.data + pos, label.data(), label.length()) != 0)
+			break ;
+		pos += label.length();
+		if (nodes_[node].location < 0)
+			continue ;
+		if (pos == length)
+			return (nodes_[node].location);
+		if (uri.data[pos - 1] == '/' || uri.data[pos] == '/')
+			prefix = nodes_[node].location;
+	}
+	if (!extensions_.empty())
+	{
+		extension = findExtension(pathExtension(StringRef(uri.data, length)));
+		if (extension >= 0)
+			return (extension);
+	}
+	if (prefix >= 0)
+		return (prefix);
+	return (0);
+}
@@ -0,0 +1,149 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   MimeTypes.cpp                                      :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: ewiese-m <ewiese-m@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/08/29 09:12:48 by ewiese-m          #+#    #+#             */
+/*   Updated: 2025/08/29 09:12:48 by ewiese-m         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "../inc/MimeTypes.hpp"
+#include "../inc/utils.hpp"
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace
+{
+
+const char *const g_defaults[][2] = {
+	{"text/html", "html htm"},
+	{"text/css", "css"},
+	{"application/javascript", "js"},
+	{"application/json", "json"},
+	{"application/xml", "xml"},
+	{"text/plain", "txt"},
+	{"application/pdf", "pdf"},
+	{"image/jpeg", "jpg jpeg"},
+	{"image/png", "png"},
+	{"image/gif", "gif"},
+	{"image/svg+xml", "svg"},
+	{"image/x-icon", "ico"},
+	{"image/webp", "webp"},
+	{"audio/mpeg", "mp3"},
+	{"audio/wav", "wav"},
+	{"video/mp4", "mp4"},
+	{"video/webm", "webm"},
+	{"audio/ogg", "ogg"},
+	{"video/x-msvideo", "avi"},
+	{"application/zip", "zip"},
+	{"application/x-tar", "tar"},
+	{"application/gzip", "gz"},
+	{"application/x-rar-compressed", "rar"},
+	{"application/msword", "doc"},
+	{"application/vnd.openxmlformats-officedocument.wordprocessingml.document", "docx"},
+	{"application/vnd.ms-excel", "xls"},
+	{"application/vnd.openxmlformats-officedocument.spreadsheetml.sheet", "xlsx"},
+	{"application/vnd.ms-powerpoint", "ppt"},
+	{"application/vnd.openxmlformats-officedocument.presentationml.presentation", "pptx"},
+	{NULL, NULL}
+};
+
+}
+
+MimeTypes::MimeTypes() : types_(), interned_(), extensions_(),
+	default_type_(0)
+{
+	std::string extension;
+
+	default_type_ = intern("application/octet-stream");
+	for (size_t i = 0; g_defaults[i][0]; i++)
+	{
+		std::istringstream extensions(g_defaults[i][1]);
+		while (extensions >> extension)
+			add(g_defaults[i][0], extension);
+	}
+}
+
+int MimeTypes::intern(const std::string &type)
+{
+	std::map<std::string, int>::const_iterator it = interned_.find(type);
+
+	if (it != interned_.end())
+		return (it->second);
+	types_.push_back(type);
+	interned_[type] = static_cast<int>(types_.size() - 1);
+	return (static_cast<int>(types_.size() - 1));
+}
+
+/*
+** Later definitions of an extension replace earlier ones, so configured
+** types override the built-in defaults.
+*/
+void MimeTypes::add(const std::string &type, const std::string &extension)
+{
+	if (extension.empty() || extension.length() > MAX_EXTENSION)
+		return;
+	extensions_.assign(extension, intern(type));
+}
+
+/*
+** One "type ext ext ..." entry, in either mime.types flavour: the Apache
+** one (one per line, no terminator) or nginx's (terminated by ';'). Lines
+** whose first word is not a type, such as "types {" and "}", are skipped.
+*/
+void MimeTypes::addLine(const std::string &line)
+{
+	std::istringstream words(line.substr(0, line.find('#')));
+	std::string type;
+	std::string extension;
+
+	if (!(words >> type) || type.find('/') == std::string::npos)
+		return;
+	while (words >> extension)
+	{
+		if (extension[extension.length() - 1] == ';')
+			extension.erase(extension.length() - 1);
+		add(type, extension);
+	}
+}
+
+void MimeTypes::load(const std::string &path)
+{
+	std::ifstream file(path.c_str());
+	std::string line;
+
+	if (!file.is_open())
+		throw std::runtime_error("Could not open types file: " + path);
+	while (std::getline(file, line))
+		addLine(line);
+}
+
+void MimeTypes::setDefault(const std::string &type)
+{
+	default_type_ = intern(type);
+}
+
+/*
+** Type for the extension of the last path segment, or the default type.
+*/
+const std::string &MimeTypes::lookup(const StringRef &path) const
+{
+	StringRef extension = pathExtension(path);
+	const int *type;
+
+	if (extension.length < 2 || extension.length - 1 > MAX_EXTENSION)
+		return (types_[default_type_]);
+	type = extensions_.find(extension.data + 1, extension.length - 1);
+	if (type == NULL)
+		return (types_[default_type_]);
+	return (types_[*type]);
+}
+
+size_t MimeTypes::size() const
+{
+	return (extensions_.size());
+}
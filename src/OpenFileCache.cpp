@@ -0,0 +1,220 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   OpenFileCache.cpp                                  :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: ewiese-m <ewiese-m@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/08/24 11:02:17 by ewiese-m          #+#    #+#             */
+/*   Updated: 2025/08/24 11:02:17 by ewiese-m         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "../inc/OpenFileCache.hpp"
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+OpenFile *OpenFile::retain(OpenFile *file)
+{
+	file->refs++;
+	return (file);
+}
+
+void OpenFile::release(OpenFile *file)
+{
+	if (--file->refs > 0)
+		return ;
+	if (file->fd >= 0)
+		close(file->fd);
+	delete file;
+}
+
+OpenFileCache::OpenFileCache() : index_(), lru_(), transient_(), max_(0),
+	inactive_(60), valid_(60), errors_(true)
+{
+}
+
+OpenFileCache::~OpenFileCache()
+{
+	sweep(0);
+	while (!index_.empty())
+		drop(index_.begin());
+}
+
+void OpenFileCache::configure(size_t max, time_t inactive, time_t valid,
+	bool errors)
+{
+	max_ = max;
+	inactive_ = inactive;
+	valid_ = valid;
+	errors_ = errors;
+}
+
+/*
+** Returns the entry for path, opening it if needed. The pointer is borrowed:
+** it stays valid until the next sweep() or invalidate() of the same path.
+** Callers that keep the fd longer take their own reference with retain().
+*/
+OpenFile *OpenFileCache::open(const std::string &path, time_t now,
+	bool need_fd)
+{
+	Index::iterator it;
+	OpenFile *file;
+
+	if (max_ > 0)
+	{
+		it = index_.find(path);
+		if (it != index_.end())
+		{
+			file = it->second;
+			if (stillValid(file, now) && !(need_fd && file->fd < 0
+					&& file->err == 0 && !file->is_dir))
+			{
+				file->accessed = now;
+				lru_.splice(lru_.begin(), lru_, file->lru);
+				return (file);
+			}
+			drop(it);
+		}
+	}
+	file = load(path, now, need_fd);
+	if (max_ == 0 || (file->err != 0 && !errors_))
+	{
+		transient_.push_back(file);
+		return (file);
+	}
+	lru_.push_front(file);
+	file->lru = lru_.begin();
+	index_[path] = file;
+	return (file);
+}
+
+void OpenFileCache::invalidate(const std::string &path)
+{
+	Index::iterator it;
+
+	it = index_.find(path);
+	if (it != index_.end())
+		drop(it);
+}
+
+/*
+** Drops every entry whose path starts with prefix: a whole directory, or
+** everything when prefix is empty.
+*/
+void OpenFileCache::invalidatePrefix(const std::string &prefix)
+{
+	Index::iterator it;
+
+	it = index_.lower_bound(prefix);
+	while (it != index_.end() && it->first.compare(0, prefix.size(), prefix) == 0)
+		drop(it++);
+}
+
+void OpenFileCache::sweep(time_t now)
+{
+	for (size_t i = 0; i < transient_.size(); i++)
+		OpenFile::release(transient_[i]);
+	transient_.clear();
+	while (!lru_.empty() && (lru_.size() > max_
+			|| lru_.back()->accessed + inactive_ <= now))
+		drop(index_.find(lru_.back()->path));
+}
+
+size_t OpenFileCache::size() const
+{
+	return (index_.size());
+}
+
+/*
+** Directories, and files looked up without need_fd, are only stat()ed; their
+** entry carries no fd. Anything that is neither a directory nor a regular file
+** is recorded as EACCES.
+*/
+OpenFile *OpenFileCache::load(const std::string &path, time_t now,
+	bool need_fd)
+{
+	OpenFile *file;
+	struct stat info;
+
+	file = new OpenFile();
+	file->path = path;
+	file->fd = -1;
+	file->err = 0;
+	file->is_dir = false;
+	file->size = 0;
+	file->mtime = 0;
+	file->inode = 0;
+	file->device = 0;
+	file->validated = now;
+	file->accessed = now;
+	file->refs = 1;
+	if (need_fd)
+	{
+		file->fd = ::open(path.c_str(), O_RDONLY | O_NONBLOCK);
+		if (file->fd >= 0 && fstat(file->fd, &info) < 0)
+		{
+			file->err = errno;
+			close(file->fd);
+			file->fd = -1;
+			return (file);
+		}
+	}
+	if (need_fd ? file->fd < 0 : stat(path.c_str(), &info) < 0)
+	{
+		file->err = errno;
+		return (file);
+	}
+	if (file->fd >= 0)
+		fcntl(file->fd, F_SETFD, FD_CLOEXEC);
+	file->is_dir = S_ISDIR(info.st_mode);
+	file->size = info.st_size;
+	file->mtime = info.st_mtime;
+	file->inode = info.st_ino;
+	file->device = info.st_dev;
+	if (file->is_dir || !S_ISREG(info.st_mode))
+	{
+		if (file->fd >= 0)
+			close(file->fd);
+		file->fd = -1;
+		if (!file->is_dir)
+			file->err = EACCES;
+	}
+	return (file);
+}
+
+/*
+** Past the validity window an entry is confirmed with one stat(): it is kept
+** if the path still names the same inode with the same size and mtime, or, for
+** a cached error, if stat() still fails the same way.
+*/
+bool OpenFileCache::stillValid(OpenFile *file, time_t now) const
+{
+	struct stat info;
+
+	if (now - file->validated < valid_)
+		return (true);
+	if (stat(file->path.c_str(), &info) < 0)
+	{
+		if (file->fd >= 0 || file->is_dir || errno != file->err)
+			return (false);
+	}
+	else if (file->err != 0 || info.st_ino != file->inode
+		|| info.st_dev != file->device || info.st_size != file->size
+		|| info.st_mtime != file->mtime)
+		return (false);
+	file->validated = now;
+	return (true);
+}
+
+void OpenFileCache::drop(Index::iterator it)
+{
+	OpenFile *file;
+
+	file = it->second;
+	lru_.erase(file->lru);
+	index_.erase(it);
+	OpenFile::release(file);
+}
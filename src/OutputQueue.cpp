@@ -0,0 +1,262 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   OutputQueue.cpp                                    :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: ewiese-m <ewiese-m@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/08/19 17:40:31 by ewiese-m          #+#    #+#             */
+/*   Updated: 2025/08/19 17:40:31 by ewiese-m         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "../inc/OutputQueue.hpp"
+#include <cerrno>
+#include <sys/uio.h>
+#include <unistd.h>
+#ifdef __linux__
+# include <sys/sendfile.h>
+#endif
+
+static const size_t MAX_IOV = 64;
+static const size_t COALESCE_LIMIT = 16384;
+static const off_t SENDFILE_CHUNK = 0x7ffff000;
+
+OutputQueue::OutputQueue() : segments_(), pending_(0)
+{
+}
+
+OutputQueue::~OutputQueue()
+{
+	clear();
+}
+
+void OutputQueue::append(const std::string &data)
+{
+	append(data.data(), data.length());
+}
+
+/*
+** Small writes are coalesced into the tail segment so pipelined responses go
+** out in as few syscalls as possible.
+*/
+void OutputQueue::append(const char *data, size_t length)
+{
+	Segment segment;
+
+	if (length == 0)
+		return ;
+	if (!segments_.empty() && !segments_.back().sealed
+		&& segments_.back().data.length() < COALESCE_LIMIT)
+	{
+		segments_.back().data.append(data, length);
+	}
+	else
+	{
+		segment.offset = 0;
+		segment.sealed = false;
+		segment.shared = NULL;
+		segment.file = NULL;
+		segment.file_offset = 0;
+		segment.file_remaining = 0;
+		segments_.push_back(segment);
+		segments_.back().data.assign(data, length);
+	}
+	pending_ += length;
+}
+
+void OutputQueue::appendFile(OpenFile *file, off_t offset, off_t length)
+{
+	Segment segment;
+
+	if (length <= 0)
+		return ;
+	segment.offset = 0;
+	segment.sealed = true;
+	segment.shared = NULL;
+	segment.file = OpenFile::retain(file);
+	segment.file_offset = offset;
+	segment.file_remaining = length;
+	segments_.push_back(segment);
+	pending_ += length;
+}
+
+/*
+** Takes over the contents of data (leaving it empty) as a segment of its own,
+** so a large body is queued without being copied. Later appends do not
+** coalesce into it.
+*/
+void OutputQueue::appendOwned(std::string &data)
+{
+	Segment segment;
+
+	if (data.empty())
+		return ;
+	segment.offset = 0;
+	segment.sealed = true;
+	segment.shared = NULL;
+	segment.file = NULL;
+	segment.file_offset = 0;
+	segment.file_remaining = 0;
+	segments_.push_back(segment);
+	segments_.back().data.swap(data);
+	pending_ += segments_.back().data.length();
+}
+
+/*
+** Queues a shared buffer by reference; it goes out in the same writev as the
+** memory segments around it.
+*/
+void OutputQueue::appendShared(SharedBuffer *buffer)
+{
+	Segment segment;
+
+	if (buffer->size() == 0)
+		return ;
+	segment.offset = 0;
+	segment.sealed = true;
+	segment.shared = buffer->retain();
+	segment.file = NULL;
+	segment.file_offset = 0;
+	segment.file_remaining = 0;
+	segments_.push_back(segment);
+	pending_ += buffer->size();
+}
+
+bool OutputQueue::empty() const
+{
+	return (pending_ == 0);
+}
+
+size_t OutputQueue::pending() const
+{
+	return (pending_);
+}
+
+FlushResult OutputQueue::flush(int fd)
+{
+	FlushResult result;
+
+	while (!segments_.empty())
+	{
+		if (segments_.front().file != NULL)
+			result = flushFile(fd, segments_.front());
+		else
+			result = flushMemory(fd);
+		if (result != FLUSH_DONE)
+			return (result);
+	}
+	return (FLUSH_DONE);
+}
+
+/*
+** Sends the run of memory segments at the front of the queue with a single
+** writev. Returns FLUSH_DONE when the run went out completely.
+*/
+FlushResult OutputQueue::flushMemory(int fd)
+{
+	struct iovec iov[MAX_IOV];
+	size_t count;
+	ssize_t written;
+	size_t left;
+
+	count = 0;
+	for (std::deque<Segment>::iterator it = segments_.begin();
+		 it != segments_.end() && it->file == NULL && count < MAX_IOV; ++it)
+	{
+		iov[count].iov_base = const_cast<char *>(bytes(*it) + it->offset);
+		iov[count].iov_len = length(*it) - it->offset;
+		count++;
+	}
+	written = writev(fd, iov, count);
+	if (written < 0)
+	{
+		if (errno == EINTR)
+			return (FLUSH_DONE);
+		if (errno == EAGAIN || errno == EWOULDBLOCK)
+			return (FLUSH_AGAIN);
+		return (FLUSH_ERROR);
+	}
+	pending_ -= written;
+	left = written;
+	while (left > 0)
+	{
+		Segment &front = segments_.front();
+		if (left < length(front) - front.offset)
+		{
+			front.offset += left;
+			return (FLUSH_AGAIN);
+		}
+		left -= length(front) - front.offset;
+		popFront();
+	}
+	return (FLUSH_DONE);
+}
+
+FlushResult OutputQueue::flushFile(int fd, Segment &segment)
+{
+	ssize_t sent;
+
+	while (segment.file_remaining > 0)
+	{
+#ifdef __linux__
+		sent = sendfile(fd, segment.file->fd, &segment.file_offset,
+			segment.file_remaining < SENDFILE_CHUNK ? segment.file_remaining : SENDFILE_CHUNK);
+#else
+		char buffer[65536];
+		ssize_t got;
+
+		got = pread(segment.file->fd, buffer, segment.file_remaining < static_cast<off_t>(sizeof(buffer))
+			? segment.file_remaining : sizeof(buffer), segment.file_offset);
+		if (got <= 0)
+			return (FLUSH_ERROR);
+		sent = write(fd, buffer, got);
+		if (sent > 0)
+			segment.file_offset += sent;
+#endif
+		if (sent < 0)
+		{
+			if (errno == EINTR)
+				continue ;
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+				return (FLUSH_AGAIN);
+			return (FLUSH_ERROR);
+		}
+		if (sent == 0)
+			return (FLUSH_ERROR);
+		segment.file_remaining -= sent;
+		pending_ -= sent;
+	}
+	popFront();
+	return (FLUSH_DONE);
+}
+
+void OutputQueue::popFront()
+{
+	if (segments_.front().file != NULL)
+		OpenFile::release(segments_.front().file);
+	if (segments_.front().shared != NULL)
+		segments_.front().shared->release();
+	segments_.pop_front();
+}
+
+const char *OutputQueue::bytes(const Segment &segment)
+{
+	if (segment.shared != NULL)
+		return (segment.shared->data());
+	return (segment.data.data());
+}
+
+size_t OutputQueue::length(const Segment &segment)
+{
+	if (segment.shared != NULL)
+		return (segment.shared->size());
+	return (segment.data.length());
+}
+
+void OutputQueue::clear()
+{
+	while (!segments_.empty())
+		popFront();
+	pending_ = 0;
+}
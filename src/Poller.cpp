@@ -0,0 +1,312 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   Poller.cpp                                         :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: ewiese-m <ewiese-m@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/08/18 11:02:14 by ewiese-m          #+#    #+#             */
+/*   Updated: 2025/08/18 11:02:14 by ewiese-m         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "../inc/Poller.hpp"
+#include <cerrno>
+#include <cstdio>
+#include <iostream>
+#include <stdexcept>
+#include <unistd.h>
+
+static const int MAX_EPOLL_EVENTS = 1024;
+
+Poller::Poller() : regs_()
+{
+}
+
+Poller::~Poller()
+{
+}
+
+bool Poller::isEdgeTriggered() const
+{
+	return (false);
+}
+
+void Poller::remember(int fd, unsigned int events, int kind, int id)
+{
+	Registration reg;
+
+	if (static_cast<size_t>(fd) >= regs_.size())
+	{
+		reg.kind = -1;
+		reg.id = -1;
+		reg.events = 0;
+		regs_.resize(fd + 1, reg);
+	}
+	regs_[fd].kind = kind;
+	regs_[fd].id = id;
+	regs_[fd].events = events;
+}
+
+Poller *Poller::create(const std::string &backend, bool edge_triggered)
+{
+	if (backend == "poll")
+	{
+		return (new PollPoller());
+	}
+#ifdef __linux__
+	if (backend == "epoll" || backend.empty())
+	{
+		return (new EpollPoller(edge_triggered));
+	}
+#else
+	(void)edge_triggered;
+	if (backend.empty())
+	{
+		return (new PollPoller());
+	}
+#endif
+	throw std::runtime_error("Unsupported event backend: " + backend);
+}
+
+/*
+** poll(2) fallback. The pollfd array is kept dense: index_ maps an fd to its
+** slot, and removal moves the last entry into the hole so it stays O(1).
+*/
+
+PollPoller::PollPoller() : fds_(), index_()
+{
+}
+
+PollPoller::~PollPoller()
+{
+}
+
+static short toPollEvents(unsigned int events)
+{
+	short result;
+
+	result = 0;
+	if (events & POLLER_IN)
+		result |= POLLIN;
+	if (events & POLLER_OUT)
+		result |= POLLOUT;
+	return (result);
+}
+
+bool PollPoller::add(int fd, unsigned int events, int kind, int id)
+{
+	struct pollfd pfd;
+
+	if (fd < 0)
+		return (false);
+	if (static_cast<size_t>(fd) >= index_.size())
+		index_.resize(fd + 1, -1);
+	if (index_[fd] != -1)
+		return (modify(fd, events));
+	pfd.fd = fd;
+	pfd.events = toPollEvents(events);
+	pfd.revents = 0;
+	index_[fd] = fds_.size();
+	fds_.push_back(pfd);
+	remember(fd, events, kind, id);
+	return (true);
+}
+
+bool PollPoller::modify(int fd, unsigned int events)
+{
+	if (fd < 0 || static_cast<size_t>(fd) >= index_.size() || index_[fd] == -1)
+		return (false);
+	fds_[index_[fd]].events = toPollEvents(events);
+	regs_[fd].events = events;
+	return (true);
+}
+
+void PollPoller::remove(int fd)
+{
+	int slot;
+
+	if (fd < 0 || static_cast<size_t>(fd) >= index_.size() || index_[fd] == -1)
+		return ;
+	slot = index_[fd];
+	if (static_cast<size_t>(slot) != fds_.size() - 1)
+	{
+		fds_[slot] = fds_.back();
+		index_[fds_[slot].fd] = slot;
+	}
+	fds_.pop_back();
+	index_[fd] = -1;
+}
+
+int PollPoller::wait(std::vector<PollEvent> &events, int timeout_ms)
+{
+	int ready;
+	PollEvent ev;
+
+	events.clear();
+	ready = poll(fds_.empty() ? NULL : &fds_[0], fds_.size(), timeout_ms);
+	if (ready < 0)
+		return (errno == EINTR ? 0 : -1);
+	for (size_t i = 0; i < fds_.size() && static_cast<int>(events.size()) < ready; i++)
+	{
+		if (fds_[i].revents == 0)
+			continue ;
+		ev.fd = fds_[i].fd;
+		ev.kind = regs_[ev.fd].kind;
+		ev.id = regs_[ev.fd].id;
+		ev.events = 0;
+		if (fds_[i].revents & POLLIN)
+			ev.events |= POLLER_IN;
+		if (fds_[i].revents & POLLOUT)
+			ev.events |= POLLER_OUT;
+		if (fds_[i].revents & (POLLHUP | POLLERR | POLLNVAL))
+			ev.events |= POLLER_ERR;
+		events.push_back(ev);
+	}
+	return (events.size());
+}
+
+const char *PollPoller::name() const
+{
+	return ("poll");
+}
+
+#ifdef __linux__
+
+/*
+** epoll(7) backend. The fd, kind and id are packed into epoll_data.u64 so a
+** ready event carries everything the loop needs to dispatch it.
+*/
+
+EpollPoller::EpollPoller(bool edge_triggered) : epfd_(-1),
+	edge_triggered_(edge_triggered), ready_(MAX_EPOLL_EVENTS)
+{
+	epfd_ = epoll_create(MAX_EPOLL_EVENTS);
+	if (epfd_ < 0)
+	{
+		throw std::runtime_error("epoll_create failed");
+	}
+}
+
+EpollPoller::~EpollPoller()
+{
+	if (epfd_ >= 0)
+		close(epfd_);
+}
+
+uint64_t EpollPoller::pack(int fd, int kind, int id)
+{
+	return (static_cast<uint64_t>(static_cast<uint32_t>(fd))
+		| (static_cast<uint64_t>(static_cast<uint8_t>(kind)) << 32)
+		| (static_cast<uint64_t>(static_cast<uint32_t>(id) & 0xffffff) << 40));
+}
+
+uint32_t EpollPoller::toEpoll(unsigned int events) const
+{
+	uint32_t result;
+
+	result = 0;
+	if (events & POLLER_IN)
+		result |= EPOLLIN | EPOLLRDHUP;
+	if (events & POLLER_OUT)
+		result |= EPOLLOUT;
+	if (edge_triggered_)
+		result |= EPOLLET;
+	return (result);
+}
+
+bool EpollPoller::add(int fd, unsigned int events, int kind, int id)
+{
+	struct epoll_event ev;
+
+	ev.events = toEpoll(events);
+	ev.data.u64 = pack(fd, kind, id);
+	if (epoll_ctl(epfd_, EPOLL_CTL_ADD, fd, &ev) < 0)
+	{
+		if (errno != EEXIST)
+		{
+			perror("epoll_ctl");
+			return (false);
+		}
+		if (epoll_ctl(epfd_, EPOLL_CTL_MOD, fd, &ev) < 0)
+		{
+			perror("epoll_ctl");
+			return (false);
+		}
+	}
+	remember(fd, events, kind, id);
+	return (true);
+}
+
+bool EpollPoller::modify(int fd, unsigned int events)
+{
+	struct epoll_event ev;
+
+	if (fd < 0 || static_cast<size_t>(fd) >= regs_.size() || regs_[fd].kind < 0)
+		return (false);
+	if (regs_[fd].events == events)
+		return (true);
+	ev.events = toEpoll(events);
+	ev.data.u64 = pack(fd, regs_[fd].kind, regs_[fd].id);
+	if (epoll_ctl(epfd_, EPOLL_CTL_MOD, fd, &ev) < 0)
+	{
+		perror("epoll_ctl");
+		return (false);
+	}
+	regs_[fd].events = events;
+	return (true);
+}
+
+void EpollPoller::remove(int fd)
+{
+	struct epoll_event ev;
+
+	if (fd < 0 || static_cast<size_t>(fd) >= regs_.size() || regs_[fd].kind < 0)
+		return ;
+	epoll_ctl(epfd_, EPOLL_CTL_DEL, fd, &ev);
+	regs_[fd].kind = -1;
+}
+
+int EpollPoller::wait(std::vector<PollEvent> &events, int timeout_ms)
+{
+	int ready;
+	PollEvent ev;
+	uint64_t data;
+	uint32_t flags;
+
+	events.clear();
+	ready = epoll_wait(epfd_, &ready_[0], ready_.size(), timeout_ms);
+	if (ready < 0)
+		return (errno == EINTR ? 0 : -1);
+	for (int i = 0; i < ready; i++)
+	{
+		data = ready_[i].data.u64;
+		flags = ready_[i].events;
+		ev.fd = static_cast<int>(data & 0xffffffff);
+		ev.kind = static_cast<int>((data >> 32) & 0xff);
+		ev.id = static_cast<int>(data >> 40);
+		ev.events = 0;
+		if (flags & EPOLLIN)
+			ev.events |= POLLER_IN;
+		if (flags & EPOLLOUT)
+			ev.events |= POLLER_OUT;
+		if (flags & (EPOLLHUP | EPOLLERR))
+			ev.events |= POLLER_ERR;
+		if ((flags & EPOLLRDHUP) && !(flags & EPOLLIN))
+			ev.events |= POLLER_ERR;
+		events.push_back(ev);
+	}
+	return (ready);
+}
+
+const char *EpollPoller::name() const
+{
+	return ("epoll");
+}
+
+bool EpollPoller::isEdgeTriggered() const
+{
+	return (edge_triggered_);
+}
+
+#endif
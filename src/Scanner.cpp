@@ -0,0 +1,71 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   Scanner.cpp                                        :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: ewiese-m <ewiese-m@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/08/27 17:48:05 by ewiese-m          #+#    #+#             */
+/*   Updated: 2025/08/27 17:48:05 by ewiese-m         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "../inc/Scanner.hpp"
+#include <cstring>
+
+/*
+** First byte in [p, end) equal to a or b, or end if there is none. a is
+** looked for first, so pass the byte expected to come first: the search
+** for b then only covers the bytes before it.
+*/
+const char *scanAny(const char *p, const char *end, char a, char b)
+{
+	const char *hit;
+	const char *other;
+
+	hit = static_cast<const char *>(std::memchr(p, a, end - p));
+	if (hit == NULL)
+		hit = end;
+	if (a == b || hit == p)
+		return (hit);
+	other = static_cast<const char *>(std::memchr(p, b, hit - p));
+	return (other ? other : hit);
+}
+
+/*
+** First empty line in [p, end): "\n\n" or "\n\r\n", the header terminator of
+** an HTTP or CGI message. Returns a pointer to the first byte of the
+** terminator (including the preceding '\r' if present) and stores its
+** length, or NULL if the block is not complete.
+*/
+const char *scanBlankLine(const char *p, const char *end, size_t *length)
+{
+	const char *start = p;
+	const char *eol;
+
+	while ((eol = scanAny(p, end, '\n', '\n')) != end)
+	{
+		if (eol + 1 < end && eol[1] == '\n')
+		{
+			*length = 2;
+			if (eol > start && eol[-1] == '\r')
+			{
+				*length = 3;
+				return (eol - 1);
+			}
+			return (eol);
+		}
+		if (eol + 2 < end && eol[1] == '\r' && eol[2] == '\n')
+		{
+			*length = 3;
+			if (eol > start && eol[-1] == '\r')
+			{
+				*length = 4;
+				return (eol - 1);
+			}
+			return (eol);
+		}
+		p = eol + 1;
+	}
+	return (NULL);
+}
@@ -14,19 +14,23 @@
 
 ServerConfig::ServerConfig() : _port(80),
                                _host("0.0.0.0"),
+                               _default_server(false),
                                _server_names(),
                                _error_pages(),
                                _client_max_body_size(0),
-                               _locations() {}
+                               _locations(),
+                               _router() {}
 
 ServerConfig::~ServerConfig() {}
 
 ServerConfig::ServerConfig(const ServerConfig &other) : _port(other._port),
                                                         _host(other._host),
+                                                        _default_server(other._default_server),
                                                         _server_names(other._server_names),
                                                         _error_pages(other._error_pages),
                                                         _client_max_body_size(other._client_max_body_size),
-                                                        _locations(other._locations) {}
+                                                        _locations(other._locations),
+                                                        _router(other._router) {}
 
 ServerConfig &ServerConfig::operator=(const ServerConfig &other)
 {
@@ -34,10 +38,12 @@ ServerConfig &ServerConfig::operator=(const ServerConfig &other)
     {
         _port = other._port;
         _host = other._host;
+        _default_server = other._default_server;
         _server_names = other._server_names;
         _error_pages = other._error_pages;
         _client_max_body_size = other._client_max_body_size;
         _locations = other._locations;
+        _router = other._router;
     }
     return *this;
 }
@@ -52,30 +58,18 @@ void ServerConfig::setPort(int port)
     _port = port;
 }
 
-const LocationConfig &ServerConfig::findLocationForRequest(const std::string &uri_path) const
+/*
+** Must be called again whenever _locations changes; the router refers to
+** locations by index.
+*/
+void ServerConfig::compileLocations()
 {
-    const LocationConfig *best_match = &_locations[0];
-    size_t best_length = 0;
-
-    for (std::vector<LocationConfig>::const_iterator it = _locations.begin();
-         it != _locations.end(); ++it)
-    {
-
-        const std::string &loc_path = it->_path;
-        const size_t loc_len = loc_path.length();
-
-        if ((uri_path == loc_path) ||
-            (uri_path.compare(0, loc_len, loc_path) == 0 &&
-             (loc_path[loc_path.size() - 1] == '/' || uri_path[loc_len] == '/')))
-        {
+    _router.compile(_locations);
+}
 
-            if (loc_len > best_length)
-            {
-                best_length = loc_len;
-                best_match = &(*it);
-            }
-        }
-    }
+const LocationConfig &ServerConfig::findLocationForRequest(const StringRef &uri) const
+{
+    int index = _router.find(uri);
 
-    return *best_match;
+    return _locations[index < 0 ? 0 : index];
 }
@@ -0,0 +1,48 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   SharedBuffer.cpp                                   :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: ewiese-m <ewiese-m@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/08/25 18:44:09 by ewiese-m          #+#    #+#             */
+/*   Updated: 2025/08/25 18:44:09 by ewiese-m         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "../inc/SharedBuffer.hpp"
+
+SharedBuffer::SharedBuffer(const std::string &data) : data_(data), refs_(1)
+{
+}
+
+SharedBuffer::~SharedBuffer()
+{
+}
+
+SharedBuffer *SharedBuffer::create(const std::string &data)
+{
+	return (new SharedBuffer(data));
+}
+
+SharedBuffer *SharedBuffer::retain()
+{
+	refs_++;
+	return (this);
+}
+
+void SharedBuffer::release()
+{
+	if (--refs_ == 0)
+		delete this;
+}
+
+const char *SharedBuffer::data() const
+{
+	return (data_.data());
+}
+
+size_t SharedBuffer::size() const
+{
+	return (data_.size());
+}
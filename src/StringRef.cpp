@@ -0,0 +1,101 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   StringRef.cpp                                      :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: ewiese-m <ewiese-m@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/08/25 09:51:26 by ewiese-m          #+#    #+#             */
+/*   Updated: 2025/08/25 09:51:26 by ewiese-m         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "../inc/StringRef.hpp"
+#include <cctype>
+#include <cstring>
+
+StringRef::StringRef() : data(""), length(0)
+{
+}
+
+StringRef::StringRef(const char *ptr, size_t len) : data(ptr), length(len)
+{
+}
+
+StringRef::StringRef(const char *literal) : data(literal),
+	length(std::strlen(literal))
+{
+}
+
+StringRef::StringRef(const std::string &str) : data(str.data()),
+	length(str.length())
+{
+}
+
+bool StringRef::empty() const
+{
+	return (length == 0);
+}
+
+size_t StringRef::size() const
+{
+	return (length);
+}
+
+std::string StringRef::str() const
+{
+	return (std::string(data, length));
+}
+
+bool StringRef::equalsIgnoreCase(const char *literal) const
+{
+	size_t i;
+
+	for (i = 0; i < length; i++)
+	{
+		if (literal[i] == '\0' || std::tolower(static_cast<unsigned char>(data[i]))
+			!= std::tolower(static_cast<unsigned char>(literal[i])))
+			return (false);
+	}
+	return (literal[i] == '\0');
+}
+
+bool StringRef::equalsIgnoreCase(const StringRef &other) const
+{
+	if (length != other.length)
+		return (false);
+	for (size_t i = 0; i < length; i++)
+	{
+		if (std::tolower(static_cast<unsigned char>(data[i]))
+			!= std::tolower(static_cast<unsigned char>(other.data[i])))
+			return (false);
+	}
+	return (true);
+}
+
+bool StringRef::operator==(const char *literal) const
+{
+	size_t i;
+
+	for (i = 0; i < length; i++)
+	{
+		if (literal[i] == '\0' || literal[i] != data[i])
+			return (false);
+	}
+	return (literal[i] == '\0');
+}
+
+bool StringRef::operator!=(const char *literal) const
+{
+	return (!(*this == literal));
+}
+
+bool StringRef::operator==(const StringRef &other) const
+{
+	return (length == other.length && std::memcmp(data, other.data, length) == 0);
+}
+
+std::ostream &operator<<(std::ostream &os, const StringRef &ref)
+{
+	return (os.write(ref.data, ref.length));
+}
@@ -0,0 +1,149 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   TimerWheel.cpp                                     :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: ewiese-m <ewiese-m@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/08/21 10:15:48 by ewiese-m          #+#    #+#             */
+/*   Updated: 2025/08/21 10:15:48 by ewiese-m         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "../inc/TimerWheel.hpp"
+
+TimerWheel::TimerWheel(size_t slots) : heads_(slots, -1), next_(), prev_(),
+	slot_(), deadline_(), current_(time(NULL)), count_(0)
+{
+}
+
+TimerWheel::~TimerWheel()
+{
+}
+
+size_t TimerWheel::slotFor(time_t deadline) const
+{
+	if (deadline <= current_)
+		deadline = current_ + 1;
+	return (static_cast<size_t>(deadline) % heads_.size());
+}
+
+void TimerWheel::link(int id, size_t slot)
+{
+	prev_[id] = -1;
+	next_[id] = heads_[slot];
+	if (heads_[slot] != -1)
+		prev_[heads_[slot]] = id;
+	heads_[slot] = id;
+	slot_[id] = slot;
+}
+
+void TimerWheel::unlink(int id)
+{
+	if (prev_[id] != -1)
+		next_[prev_[id]] = next_[id];
+	else
+		heads_[slot_[id]] = next_[id];
+	if (next_[id] != -1)
+		prev_[next_[id]] = prev_[id];
+	slot_[id] = -1;
+}
+
+void TimerWheel::schedule(int id, time_t deadline)
+{
+	if (id < 0)
+		return ;
+	if (static_cast<size_t>(id) >= slot_.size())
+	{
+		next_.resize(id + 1, -1);
+		prev_.resize(id + 1, -1);
+		slot_.resize(id + 1, -1);
+		deadline_.resize(id + 1, 0);
+	}
+	if (slot_[id] != -1)
+	{
+		if (deadline >= deadline_[id])
+		{
+			deadline_[id] = deadline;
+			return ;
+		}
+		unlink(id);
+		count_--;
+	}
+	deadline_[id] = deadline;
+	link(id, slotFor(deadline));
+	count_++;
+}
+
+void TimerWheel::cancel(int id)
+{
+	if (id < 0 || static_cast<size_t>(id) >= slot_.size() || slot_[id] == -1)
+		return ;
+	unlink(id);
+	count_--;
+}
+
+/*
+** Walks every slot between the last processed second and now. Entries whose
+** deadline has passed are reported, the others (refreshed or more than one
+** revolution away) are relinked where they belong.
+*/
+void TimerWheel::expire(time_t now, std::vector<int> &expired)
+{
+	size_t steps;
+	size_t slot;
+	int id;
+	int next;
+
+	expired.clear();
+	if (now <= current_)
+		return ;
+	steps = static_cast<size_t>(now - current_);
+	if (steps > heads_.size())
+		steps = heads_.size();
+	for (size_t i = 1; i <= steps; i++)
+	{
+		slot = static_cast<size_t>(current_ + i) % heads_.size();
+		id = heads_[slot];
+		heads_[slot] = -1;
+		while (id != -1)
+		{
+			next = next_[id];
+			slot_[id] = -1;
+			if (deadline_[id] <= now)
+			{
+				expired.push_back(id);
+				count_--;
+			}
+			else
+				link(id, static_cast<size_t>(deadline_[id]) % heads_.size());
+			id = next;
+		}
+	}
+	current_ = now;
+}
+
+/*
+** Milliseconds until the next occupied slot, or -1 when nothing is scheduled.
+*/
+int TimerWheel::nextTimeout(time_t now) const
+{
+	time_t tick;
+
+	if (count_ == 0)
+		return (-1);
+	for (size_t i = 1; i <= heads_.size(); i++)
+	{
+		if (heads_[(current_ + i) % heads_.size()] != -1)
+		{
+			tick = current_ + i;
+			return (tick <= now ? 0 : static_cast<int>(tick - now) * 1000);
+		}
+	}
+	return (0);
+}
+
+bool TimerWheel::empty() const
+{
+	return (count_ == 0);
+}
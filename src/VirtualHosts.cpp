@@ -0,0 +1,168 @@
+/* ************************************************************************** */
+/*                                                                            */
+/*                                                        :::      ::::::::   */
+/*   VirtualHosts.cpp                                   :+:      :+:    :+:   */
+/*                                                    +:+ +:+         +:+     */
+/*   By: ewiese-m <ewiese-m@student.42.fr>          +#+  +:+       +#+        */
+/*                                                +#+#+#+#+#+   +#+           */
+/*   Created: 2025/08/28 15:40:22 by ewiese-m          #+#    #+#             */
+/*   Updated: 2025/08/28 15:40:22 by ewiese-m         ###   ########.fr       */
+/*                                                                            */
+/* ************************************************************************** */
+
+#include "../inc/VirtualHosts.hpp"
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+namespace
+{
+
+std::string normalizeHost(const std::string &host)
+{
+	if (host.empty())
+		return ("0.0.0.0");
+	if (host == "localhost")
+		return ("127.0.0.1");
+	return (host);
+}
+
+}
+
+VirtualHosts::VirtualHosts() : listeners_(), indexes_()
+{
+}
+
+/*
+** The pointers refer into servers, which must outlive the index and not be
+** resized afterwards.
+*/
+void VirtualHosts::build(const std::vector<ServerConfig> &servers)
+{
+	std::string host;
+	size_t id;
+
+	listeners_.clear();
+	indexes_.clear();
+	for (size_t i = 0; i < servers.size(); i++)
+	{
+		host = normalizeHost(servers[i]._host);
+		for (id = 0; id < listeners_.size(); id++)
+		{
+			if (listeners_[id].host == host && listeners_[id].port == servers[i]._port)
+				break;
+		}
+		if (id == listeners_.size())
+		{
+			listeners_.push_back(Listener());
+			listeners_[id].host = host;
+			listeners_[id].port = servers[i]._port;
+			listeners_[id].default_server = &servers[i];
+			listeners_[id].bound = true;
+			listeners_[id].shadows = false;
+			indexes_.push_back(Index());
+		}
+		else if (servers[i]._default_server)
+		{
+			if (listeners_[id].default_server->_default_server)
+			{
+				std::ostringstream where;
+				where << host << ":" << servers[i]._port;
+				throw std::runtime_error("Duplicate default_server for " + where.str());
+			}
+			listeners_[id].default_server = &servers[i];
+		}
+		listeners_[id].servers.push_back(&servers[i]);
+		for (size_t j = 0; j < servers[i]._server_names.size(); j++)
+			addName(id, servers[i]._server_names[j], &servers[i]);
+	}
+	for (size_t w = 0; w < listeners_.size(); w++)
+	{
+		if (listeners_[w].host != "0.0.0.0")
+			continue;
+		for (size_t l = 0; l < listeners_.size(); l++)
+		{
+			if (l != w && listeners_[l].port == listeners_[w].port)
+			{
+				listeners_[l].bound = false;
+				listeners_[w].shadows = true;
+			}
+		}
+	}
+}
+
+void VirtualHosts::addName(size_t id, const std::string &name,
+	const ServerConfig *server)
+{
+	bool added;
+
+	if (name.length() > 2 && name.compare(0, 2, "*.") == 0)
+		added = indexes_[id].leading.insert(name.substr(1), server);
+	else if (name.length() > 2 && name.compare(name.length() - 2, 2, ".*") == 0)
+		added = indexes_[id].trailing.insert(name.substr(0, name.length() - 1), server);
+	else
+		added = indexes_[id].exact.insert(name, server);
+	if (!added)
+		std::cerr << "⚠️  Conflicting server name \"" << name << "\" on "
+				  << listeners_[id].host << ":" << listeners_[id].port
+				  << ", ignored" << std::endl;
+}
+
+size_t VirtualHosts::size() const
+{
+	return (listeners_.size());
+}
+
+const VirtualHosts::Listener &VirtualHosts::listener(size_t id) const
+{
+	return (listeners_[id]);
+}
+
+/*
+** For a connection accepted on wildcard listener id: the listener configured
+** for the exact local address it arrived on, or id itself.
+*/
+size_t VirtualHosts::byLocalAddress(size_t id, const std::string &host) const
+{
+	for (size_t i = 0; i < listeners_.size(); i++)
+	{
+		if (!listeners_[i].bound && listeners_[i].port == listeners_[id].port
+			&& listeners_[i].host == host)
+			return (i);
+	}
+	return (id);
+}
+
+/*
+** Host is matched without its port and trailing dot, case-insensitively.
+** Names longer than any valid DNS name go straight to the default server.
+*/
+const ServerConfig *VirtualHosts::resolve(size_t id, const StringRef &host) const
+{
+	const Index &index = indexes_[id];
+	const ServerConfig *const *server;
+	const char *name;
+	size_t length;
+
+	length = 0;
+	while (length < host.length && host.data[length] != ':')
+		length++;
+	if (length > 0 && host.data[length - 1] == '.')
+		length--;
+	if (length == 0 || length > MAX_HOST_LENGTH)
+		return (listeners_[id].default_server);
+	name = host.data;
+	if ((server = index.exact.find(name, length)))
+		return (*server);
+	for (size_t i = 0; i < length; i++)
+	{
+		if (name[i] == '.' && (server = index.leading.find(name + i, length - i)))
+			return (*server);
+	}
+	for (size_t i = length; i-- > 0;)
+	{
+		if (name[i] == '.' && (server = index.trailing.find(name, i + 1)))
+			return (*server);
+	}
+	return (listeners_[id].default_server);
+}
@@ -11,8 +11,11 @@
 /* ************************************************************************** */
 
 #include "../inc/CGI.hpp"
+#include "../inc/Clock.hpp"
+#include "../inc/Config.hpp"
 #include "../inc/HttpRequest.hpp"
 #include "../inc/HttpResponse.hpp"
+#include "../inc/OutputQueue.hpp"
 #include "../inc/WebServer.hpp"
 #include "../inc/utils.hpp"
 #include <algorithm>
@@ -21,58 +24,85 @@
 #include <cstdio>
 #include <cstring>
 #include <dirent.h>
+#include <csignal>
+#include <cstdlib>
 #include <fcntl.h>
 #include <iostream>
 #include <map>
+#include <sched.h>
 #include <sstream>
+#include <sys/resource.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
+#include <sys/wait.h>
 #include <unistd.h>
 
-struct ClientConnection
-{
-	int fd;
-	std::string buffer;
-	time_t last_activity;
-	bool keep_alive;
-	const ServerConfig *server;
-	std::string client_ip;
-};
-
-static std::map<int, ClientConnection> g_clients;
 static const int BUFFER_SIZE = 8192;
 static const int TIMEOUT_SECONDS = 30;
+static const size_t PREALLOCATED_CLIENTS = 1024;
+static const size_t MAX_HEADER_SIZE = 64 * 1024;
+static const size_t OUTPUT_HIGH_WATER = 256 * 1024;
+static const size_t MAX_RANGES = 32;
+static const int WORKER_RETRY_SECONDS = 1;
+static const int WORKER_MIN_UPTIME = 2;
+static const int WORKER_MAX_FAILURES = 5;
+static volatile sig_atomic_t g_master_stop = 0;
+
+static void masterSignalHandler(int signum)
+{
+	(void)signum;
+	g_master_stop = 1;
+}
 
-WebServer::WebServer(const std::vector<ServerConfig> &servers) : _servers(servers)
+WebServer::WebServer(const Config &config) : _servers(config.getServers()),
+	_vhosts(), _mime_types(config.getMimeTypes()), _error_pages(),
+	_event_backend(config.getEventBackend()),
+	_edge_triggered(config.isEdgeTriggered()),
+	_worker_processes(config.getWorkerProcesses()),
+	_worker_cpu_affinity(config.getWorkerCpuAffinity()), _worker_id(-1),
+	_poller(NULL), _events(), _clients(), _timers(), _open_files(),
+	_content_cache(), _directories(), _expired(), _ranges()
 {
+	_open_files.configure(config.getOpenFileCacheMax(),
+		config.getOpenFileCacheInactive(), config.getOpenFileCacheValid(),
+		config.getOpenFileCacheErrors());
+	_content_cache.configure(config.getStaticCacheMax(),
+		config.getStaticCacheEntryMax());
+	_directories.configure(config.getOpenFileCacheValid());
+	_vhosts.build(_servers);
+	_error_pages.build(_servers);
 }
 
 WebServer::~WebServer()
 {
-	for (size_t i = 0; i < _poll_fds.size(); i++)
+	for (int fd = 0; fd <= _clients.maxFd(); fd++)
 	{
-		close(_poll_fds[i].fd);
+		if (_clients.find(fd))
+			close(fd);
 	}
-	g_clients.clear();
+	for (size_t i = 0; i < _server_fds.size(); i++)
+	{
+		close(_server_fds[i]);
+	}
+	delete _poller;
 }
 
+/*
+** One socket per listener (distinct host:port), registered with the
+** listener's id so accepted connections know which server group they
+** belong to. A listener that fails to bind is skipped.
+*/
 void WebServer::setupSockets()
 {
 	int server_fd;
 	int opt;
 	sockaddr_in addr;
-	struct pollfd pfd;
 
-	std::map<std::string, int> used_addresses;
-	for (size_t i = 0; i < _servers.size(); i++)
+	for (size_t i = 0; i < _vhosts.size(); i++)
 	{
-		std::ostringstream addr_key;
-		addr_key << _servers[i]._host << ":" << _servers[i]._port;
-		if (used_addresses.find(addr_key.str()) != used_addresses.end())
-		{
-			std::cout << "Already listening on " << addr_key.str() << std::endl;
+		const VirtualHosts::Listener &listener = _vhosts.listener(i);
+		if (!listener.bound)
 			continue;
-		}
 		server_fd = socket(AF_INET, SOCK_STREAM, 0);
 		if (server_fd < 0)
 		{
@@ -87,28 +117,25 @@ void WebServer::setupSockets()
 			close(server_fd);
 			continue;
 		}
+#ifdef SO_REUSEPORT
+		if (_worker_id >= 0 && setsockopt(server_fd, SOL_SOCKET, SO_REUSEPORT,
+										  &opt, sizeof(opt)) < 0)
+		{
+			perror("setsockopt(SO_REUSEPORT)");
+			close(server_fd);
+			continue;
+		}
+#endif
 		fcntl(server_fd, F_SETFL, O_NONBLOCK);
 		std::memset(&addr, 0, sizeof(addr));
 		addr.sin_family = AF_INET;
-		if (_servers[i]._host == "0.0.0.0" || _servers[i]._host.empty())
-		{
-			addr.sin_addr.s_addr = INADDR_ANY;
-		}
-		else if (_servers[i]._host == "localhost" || _servers[i]._host == "127.0.0.1")
+		if (inet_pton(AF_INET, listener.host.c_str(), &addr.sin_addr) <= 0)
 		{
-			addr.sin_addr.s_addr = inet_addr("127.0.0.1");
-		}
-		else
-		{
-			if (inet_pton(AF_INET, _servers[i]._host.c_str(),
-						  &addr.sin_addr) <= 0)
-			{
-				std::cerr << "Invalid address: " << _servers[i]._host << std::endl;
-				close(server_fd);
-				continue;
-			}
+			std::cerr << "Invalid address: " << listener.host << std::endl;
+			close(server_fd);
+			continue;
 		}
-		addr.sin_port = htons(_servers[i]._port);
+		addr.sin_port = htons(listener.port);
 		if (bind(server_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0)
 		{
 			perror("bind");
@@ -121,24 +148,33 @@ void WebServer::setupSockets()
 			close(server_fd);
 			continue;
 		}
-		pfd.fd = server_fd;
-		pfd.events = POLLIN;
-		_poll_fds.push_back(pfd);
+		if (!_poller->add(server_fd, POLLER_IN, FD_LISTENER, i))
+		{
+			close(server_fd);
+			continue;
+		}
 		_server_fds.push_back(server_fd);
-		used_addresses[addr_key.str()] = server_fd;
-		std::cout << "✓ Listening on " << _servers[i]._host << ":" << _servers[i]._port;
-		if (!_servers[i]._server_names.empty())
+		if (_worker_id > 0)
+			continue;
+		std::cout << "✓ Listening on " << listener.host << ":" << listener.port;
+		for (size_t j = 0; j < listener.servers.size(); j++)
 		{
-			std::cout << " (";
-			for (size_t j = 0; j < _servers[i]._server_names.size(); j++)
-			{
-				if (j > 0)
-					std::cout << ", ";
-				std::cout << _servers[i]._server_names[j];
-			}
-			std::cout << ")";
+			const std::vector<std::string> &names = listener.servers[j]->_server_names;
+			std::cout << (j == 0 ? " (" : "; ");
+			for (size_t k = 0; k < names.size(); k++)
+				std::cout << (k > 0 ? ", " : "") << names[k];
+			if (names.empty())
+				std::cout << "-";
+			if (listener.servers[j] == listener.default_server)
+				std::cout << " [default]";
+		}
+		std::cout << ")" << std::endl;
+		for (size_t j = 0; j < _vhosts.size(); j++)
+		{
+			if (!_vhosts.listener(j).bound && _vhosts.listener(j).port == listener.port)
+				std::cout << "  ↳ " << _vhosts.listener(j).host << ":"
+						  << listener.port << " via the wildcard socket" << std::endl;
 		}
-		std::cout << std::endl;
 	}
 	if (_server_fds.empty())
 	{
@@ -148,287 +184,476 @@ void WebServer::setupSockets()
 
 void WebServer::run()
 {
+	if (_worker_processes > 1)
+	{
+		runMaster();
+		return;
+	}
+	runWorker();
+}
+
+void WebServer::runWorker()
+{
+	struct rlimit limit;
+	int notify_fd;
+
+	_poller = Poller::create(_event_backend, _edge_triggered);
+	if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur != RLIM_INFINITY)
+		_clients.reserve(std::min<size_t>(PREALLOCATED_CLIENTS, limit.rlim_cur), limit.rlim_cur);
+	else
+		_clients.reserve(PREALLOCATED_CLIENTS, PREALLOCATED_CLIENTS);
+	if (_worker_id <= 0)
+	{
+		std::cout << "✓ Event backend: " << _poller->name()
+				  << (_poller->isEdgeTriggered() ? " (edge-triggered)" : "") << std::endl;
+	}
 	setupSockets();
-	std::cout << "\n🚀 Webserv started successfully!\n"
-			  << std::endl;
+	notify_fd = _content_cache.start();
+	if (notify_fd >= 0)
+		_poller->add(notify_fd, POLLER_IN, FD_NOTIFY, 0);
+	if (_worker_id < 0)
+	{
+		std::cout << "\n🚀 Webserv started successfully!\n"
+				  << std::endl;
+	}
 	mainLoop();
 }
 
+/*
+** Master process: forks the workers, each of which binds its own
+** SO_REUSEPORT listeners and runs its own event loop, and respawns any worker
+** that dies until SIGINT/SIGTERM tells it to shut everything down. A fork
+** that fails is retried on the next tick instead of leaving the slot empty.
+** A worker that keeps dying right after starting (it cannot bind, say) will
+** not get better by being restarted, so after WORKER_MAX_FAILURES such exits
+** in a row the master stops the others and gives up.
+*/
+void WebServer::runMaster()
+{
+	std::vector<pid_t> workers(_worker_processes, -1);
+	std::vector<time_t> started(_worker_processes, 0);
+	std::vector<int> failures(_worker_processes, 0);
+	struct sigaction sa;
+	pid_t pid;
+	int status;
+	int missing;
+	int failed;
+
+	std::memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = masterSignalHandler;
+	sigemptyset(&sa.sa_mask);
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+	for (int i = 0; i < _worker_processes; i++)
+	{
+		workers[i] = spawnWorker(i);
+		started[i] = time(NULL);
+	}
+	std::cout << "\n🚀 Webserv started successfully! (" << _worker_processes
+			  << " workers)\n" << std::endl;
+	failed = -1;
+	while (!g_master_stop && failed < 0)
+	{
+		missing = 0;
+		for (int i = 0; i < _worker_processes; i++)
+		{
+			if (workers[i] < 0 && time(NULL) - started[i] >= WORKER_RETRY_SECONDS)
+			{
+				workers[i] = spawnWorker(i);
+				started[i] = time(NULL);
+			}
+			if (workers[i] < 0)
+				missing++;
+		}
+		pid = waitpid(-1, &status, missing ? WNOHANG : 0);
+		if (pid == 0 || (pid < 0 && errno == ECHILD && missing))
+		{
+			sleep(WORKER_RETRY_SECONDS);
+			continue;
+		}
+		if (pid < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			perror("waitpid");
+			break;
+		}
+		for (int i = 0; i < _worker_processes; i++)
+		{
+			if (workers[i] != pid)
+				continue;
+			workers[i] = -1;
+			if (time(NULL) - started[i] < WORKER_MIN_UPTIME)
+				failures[i]++;
+			else
+				failures[i] = 0;
+			if (failures[i] >= WORKER_MAX_FAILURES)
+			{
+				failed = i;
+				break;
+			}
+			std::cerr << "⚠️  Worker " << i << " (pid " << pid << ") exited, respawning" << std::endl;
+			if (!failures[i])
+				started[i] = 0;
+			break;
+		}
+	}
+	std::cout << "\n\n🛑 Shutting down webserv..." << std::endl;
+	for (int i = 0; i < _worker_processes; i++)
+	{
+		if (workers[i] > 0)
+			kill(workers[i], SIGTERM);
+	}
+	while (waitpid(-1, &status, 0) > 0 || errno == EINTR)
+		;
+	if (failed >= 0)
+	{
+		std::ostringstream oss;
+
+		oss << "Worker " << failed << " died right after starting "
+			<< WORKER_MAX_FAILURES << " times in a row";
+		throw std::runtime_error(oss.str());
+	}
+}
+
+pid_t WebServer::spawnWorker(int worker_id)
+{
+	pid_t pid;
+
+	pid = fork();
+	if (pid < 0)
+	{
+		perror("fork");
+		return (-1);
+	}
+	if (pid > 0)
+		return (pid);
+	signal(SIGINT, SIG_DFL);
+	signal(SIGTERM, SIG_DFL);
+	_worker_id = worker_id;
+#ifdef __linux__
+	if (_worker_cpu_affinity)
+	{
+		cpu_set_t set;
+		long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+		CPU_ZERO(&set);
+		CPU_SET(worker_id % (cpus > 0 ? cpus : 1), &set);
+		if (sched_setaffinity(0, sizeof(set), &set) < 0)
+			perror("sched_setaffinity");
+	}
+#endif
+	try
+	{
+		runWorker();
+	}
+	catch (const std::exception &e)
+	{
+		std::cerr << "❌ Worker " << worker_id << ": " << e.what() << std::endl;
+	}
+	exit(EXIT_FAILURE);
+}
+
+/*
+** A client event can carry readiness for both directions at once; the
+** write side goes first, then the read side if the client is still open.
+** With edge-triggered epoll a dropped IN would not be reported again.
+*/
 void WebServer::mainLoop()
 {
 	int activity;
 
+	Clock::update();
 	while (true)
 	{
 		checkTimeouts();
-		activity = poll(_poll_fds.data(), _poll_fds.size(), 1000);
+		_open_files.sweep(Clock::now());
+		activity = _poller->wait(_events, _timers.nextTimeout(Clock::now()));
 		if (activity < 0)
 		{
-			if (errno != EINTR)
-			{
-				perror("poll");
-				break;
-			}
-			continue;
+			perror(_poller->name());
+			break;
 		}
-		for (size_t i = 0; i < _poll_fds.size(); i++)
+		Clock::update();
+		for (size_t i = 0; i < _events.size(); i++)
 		{
-			if (_poll_fds[i].revents & POLLIN)
+			const PollEvent &ev = _events[i];
+			if (ev.kind == FD_LISTENER)
 			{
-				if (std::find(_server_fds.begin(), _server_fds.end(),
-							  _poll_fds[i].fd) != _server_fds.end())
+				if (ev.events & POLLER_IN)
 				{
-					acceptNewConnection(_poll_fds[i].fd);
-				}
-				else
-				{
-					handleClientData(_poll_fds[i].fd);
+					acceptNewConnection(ev.fd, ev.id);
 				}
 			}
-			else if (_poll_fds[i].revents & (POLLHUP | POLLERR | POLLNVAL))
+			else if (ev.kind == FD_NOTIFY)
 			{
-				if (std::find(_server_fds.begin(), _server_fds.end(),
-							  _poll_fds[i].fd) == _server_fds.end())
-				{
-					removeClient(_poll_fds[i].fd);
-				}
+				_content_cache.handleEvents(_open_files);
+			}
+			else if (ev.events & (POLLER_IN | POLLER_OUT))
+			{
+				if (ev.events & POLLER_OUT)
+					handleClientWrite(ev.fd);
+				if ((ev.events & POLLER_IN) && _clients.find(ev.fd))
+					handleClientData(ev.fd);
+			}
+			else if (ev.events & POLLER_ERR)
+			{
+				removeClient(ev.fd);
 			}
 		}
 	}
 }
 
-void WebServer::acceptNewConnection(int server_fd)
+void WebServer::acceptNewConnection(int server_fd, int listener)
 {
 	sockaddr_in client_addr;
 	socklen_t client_len;
 	int client_fd;
-	struct pollfd client_pfd;
-	ClientConnection conn;
+	ClientConnection *conn;
 	char client_ip[INET_ADDRSTRLEN];
+	char local_ip[INET_ADDRSTRLEN];
 	sockaddr_in local_addr;
 	socklen_t local_len;
-	int local_port;
+	int id;
 
-	client_len = sizeof(client_addr);
-	client_fd = accept(server_fd, (struct sockaddr *)&client_addr, &client_len);
-	if (client_fd < 0)
-	{
-		if (errno != EAGAIN && errno != EWOULDBLOCK)
-		{
-			perror("accept");
-		}
-		return;
-	}
-	fcntl(client_fd, F_SETFL, O_NONBLOCK);
-	client_pfd.fd = client_fd;
-	client_pfd.events = POLLIN;
-	_poll_fds.push_back(client_pfd);
-	conn.fd = client_fd;
-	conn.buffer = "";
-	conn.last_activity = time(NULL);
-	conn.keep_alive = false;
-	inet_ntop(AF_INET, &client_addr.sin_addr, client_ip, sizeof(client_ip));
-	conn.client_ip = client_ip;
-	conn.server = &_servers[0];
-	local_len = sizeof(local_addr);
-	if (getsockname(server_fd, (struct sockaddr *)&local_addr, &local_len) == 0)
+	while (true)
 	{
-		local_port = ntohs(local_addr.sin_port);
-		for (size_t i = 0; i < _servers.size(); i++)
+		client_len = sizeof(client_addr);
+		client_fd = accept(server_fd, (struct sockaddr *)&client_addr, &client_len);
+		if (client_fd < 0)
 		{
-			if (_servers[i]._port == local_port)
+			if (errno != EAGAIN && errno != EWOULDBLOCK)
 			{
-				conn.server = &_servers[i];
-				break;
+				perror("accept");
 			}
+			return;
+		}
+		fcntl(client_fd, F_SETFL, O_NONBLOCK);
+		if (!_poller->add(client_fd, POLLER_IN, FD_CLIENT, 0))
+		{
+			close(client_fd);
+			continue;
 		}
+		conn = _clients.acquire(client_fd);
+		_timers.schedule(client_fd, Clock::now() + TIMEOUT_SECONDS);
+		inet_ntop(AF_INET, &client_addr.sin_addr, client_ip, sizeof(client_ip));
+		conn->client_ip = client_ip;
+		id = listener;
+		local_len = sizeof(local_addr);
+		if (_vhosts.listener(listener).shadows
+			&& getsockname(client_fd, (struct sockaddr *)&local_addr, &local_len) == 0
+			&& inet_ntop(AF_INET, &local_addr.sin_addr, local_ip, sizeof(local_ip)))
+			id = _vhosts.byLocalAddress(listener, local_ip);
+		conn->listener = id;
+		conn->server = _vhosts.listener(id).default_server;
+		std::cout << "✓ New client connected: " << client_ip << " (fd: " << client_fd << ")" << std::endl;
 	}
-	g_clients[client_fd] = conn;
-	std::cout << "✓ New client connected: " << client_ip << " (fd: " << client_fd << ")" << std::endl;
 }
 
 void WebServer::handleClientData(int client_fd)
 {
-	char buffer[BUFFER_SIZE];
-	ssize_t bytes;
-
-	std::map<int, ClientConnection>::iterator it = g_clients.find(client_fd);
-	if (it == g_clients.end())
+	ClientConnection *client = _clients.find(client_fd);
+	if (!client)
 	{
 		return;
 	}
-	ClientConnection &conn = it->second;
-	conn.last_activity = time(NULL);
-	bytes = recv(client_fd, buffer, sizeof(buffer) - 1, 0);
-	if (bytes <= 0)
-	{
-		if (bytes == 0 || (errno != EAGAIN && errno != EWOULDBLOCK))
-		{
-			std::cout << "Client disconnected: " << conn.client_ip << " (fd: " << client_fd << ")" << std::endl;
-			removeClient(client_fd);
-		}
-		return;
-	}
-	buffer[bytes] = '\0';
-	conn.buffer.append(buffer, bytes);
-	if (isCompleteRequest(conn.buffer))
-	{
-		processRequest(conn);
-		conn.buffer.clear();
-		if (!conn.keep_alive)
-		{
-			removeClient(client_fd);
-		}
-	}
-	else if (conn.buffer.size() > 1024 * 1024)
+	_timers.schedule(client_fd, Clock::now() + TIMEOUT_SECONDS);
+	if (readClient(*client))
 	{
-		sendErrorResponse(client_fd, 413, "Payload Too Large", conn.server);
-		removeClient(client_fd);
+		serviceRequests(*client);
 	}
 }
 
-bool WebServer::isCompleteRequest(const std::string &buffer)
+/*
+** In edge-triggered mode the socket is drained until EAGAIN, since what is
+** left would not be reported again, but only while the buffer still lacks a
+** whole request: once one (or a parse error, or an oversized request) is
+** buffered, reading stops and input_pending tells serviceRequests() to come
+** back for the rest after answering it. A client that pipelines without
+** reading responses thus cannot grow the buffer past one request. Returns
+** false when the client was removed.
+*/
+bool WebServer::readClient(ClientConnection &conn)
 {
-	size_t content_length;
-	size_t pos;
-	size_t end;
-	size_t body_start;
-	size_t body_length;
+	char buffer[BUFFER_SIZE];
+	ssize_t bytes;
 
-	if (buffer.find("\r\n\r\n") == std::string::npos && buffer.find("\n\n") == std::string::npos)
-	{
-		return (false);
-	}
-	content_length = 0;
-	pos = buffer.find("Content-Length:");
-	if (pos == std::string::npos)
+	conn.input_pending = false;
+	do
 	{
-		pos = buffer.find("content-length:");
-	}
-	if (pos != std::string::npos)
-	{
-		end = buffer.find("\r\n", pos);
-		if (end == std::string::npos)
+		bytes = recv(conn.fd, buffer, sizeof(buffer), 0);
+		if (bytes < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
 		{
-			end = buffer.find("\n", pos);
+			return (true);
 		}
-		if (end != std::string::npos)
+		if (bytes <= 0)
 		{
-			std::string length_str = buffer.substr(pos + 15, end - pos - 15);
-			std::istringstream iss(length_str);
-			iss >> content_length;
-			body_start = buffer.find("\r\n\r\n");
-			if (body_start == std::string::npos)
-			{
-				body_start = buffer.find("\n\n");
-				if (body_start != std::string::npos)
-				{
-					body_start += 2;
-				}
-			}
-			else
-			{
-				body_start += 4;
-			}
-			if (body_start != std::string::npos)
-			{
-				body_length = buffer.length() - body_start;
-				return (body_length >= content_length);
-			}
+			std::cout << "Client disconnected: " << conn.client_ip << " (fd: " << conn.fd << ")" << std::endl;
+			removeClient(conn.fd);
+			return (false);
 		}
-	}
+		conn.buffer.append(buffer, bytes);
+	} while (_poller->isEdgeTriggered()
+			 && conn.request.parse(conn.buffer) == HttpRequest::PARSE_INCOMPLETE
+			 && !requestTooLarge(conn));
+	conn.input_pending = _poller->isEdgeTriggered();
 	return (true);
 }
 
-void WebServer::processRequest(ClientConnection &conn)
+/*
+** Answers every complete request sitting in the buffer, in order, keeping the
+** bytes of a trailing partial request for the next read. Responses pile up in
+** the output queue and go out together in one flush. Parsing pauses while a
+** lot of output is pending, or a directory listing is still being streamed,
+** and resumes from handleClientWrite once it drains. When the buffer runs
+** out of whole requests and readClient() left bytes in the socket, it reads
+** on from there.
+*/
+void WebServer::serviceRequests(ClientConnection &conn)
 {
-	HttpRequest request;
-	size_t colon;
-	bool method_allowed;
+	HttpRequest::ParseStatus status;
 
-	if (!request.parse(conn.buffer))
-	{
-		sendErrorResponse(conn.fd, 400, "Bad Request", conn.server);
-		return;
-	}
-	std::string host = request.getHeader("host");
-	if (!host.empty())
+	while (true)
 	{
-		colon = host.find(':');
-		if (colon != std::string::npos)
-		{
-			host = host.substr(0, colon);
-		}
-		for (size_t i = 0; i < _servers.size(); i++)
+		while (!conn.close_after_write && !conn.listing.active()
+			   && conn.output.pending() < OUTPUT_HIGH_WATER)
 		{
-			for (size_t j = 0; j < _servers[i]._server_names.size(); j++)
+			status = conn.request.parse(conn.buffer);
+			if (status == HttpRequest::PARSE_INCOMPLETE)
 			{
-				if (_servers[i]._server_names[j] == host && _servers[i]._port == conn.server->_port)
-				{
-					conn.server = &_servers[i];
-					break;
-				}
+				break;
 			}
+			if (status == HttpRequest::PARSE_ERROR)
+			{
+				conn.keep_alive = false;
+				sendErrorResponse(conn, conn.request.getErrorStatus(),
+					HttpResponse::reasonPhrase(conn.request.getErrorStatus()).str());
+				conn.close_after_write = true;
+				break;
+			}
+			processRequest(conn);
+			conn.buffer.erase(0, conn.request.getLength());
+			conn.request.reset();
+			conn.server_resolved = false;
+			conn.close_after_write = !conn.keep_alive;
 		}
-	}
-	std::cout << "📥 " << request.getMethod() << " " << request.getUri() << " from " << conn.client_ip << " (fd:" << conn.fd << ")"
-			  << " [Server: " << (conn.server->_server_names.empty() ? "default" : conn.server->_server_names[0]) << "]" << std::endl;
-	std::string connection = request.getHeader("connection");
-	conn.keep_alive = (request.getHttpVersion() == "HTTP/1.1" && toLowerCase(connection) != "close") || (toLowerCase(connection) == "keep-alive");
-	if (request.getBody().size() > conn.server->_client_max_body_size)
-	{
-		sendErrorResponse(conn.fd, 413, "Payload Too Large", conn.server);
-		return;
-	}
-	const LocationConfig &location = conn.server->findLocationForRequest(request.getUri());
-	if (!location._allowed_methods.empty())
-	{
-		method_allowed = false;
-		for (size_t i = 0; i < location._allowed_methods.size(); i++)
+		if (conn.close_after_write)
+		{
+			conn.buffer.clear();
+		}
+		else if (requestTooLarge(conn))
 		{
-			if (location._allowed_methods[i] == request.getMethod())
+			conn.keep_alive = false;
+			sendErrorResponse(conn, 413, "Payload Too Large");
+			conn.close_after_write = true;
+			conn.buffer.clear();
+		}
+		if (!flushClient(conn) || conn.close_after_write)
+		{
+			return;
+		}
+		if (conn.request.parse(conn.buffer) != HttpRequest::PARSE_INCOMPLETE)
+		{
+			if (!conn.output.empty())
 			{
-				method_allowed = true;
-				break;
+				return;
 			}
 		}
-		if (!method_allowed)
+		else if (!conn.input_pending || conn.output.pending() >= OUTPUT_HIGH_WATER
+				 || !readClient(conn))
 		{
-			sendErrorResponse(conn.fd, 405, "Method Not Allowed", conn.server);
 			return;
 		}
 	}
-	if (request.getMethod() == "GET" || request.getMethod() == "HEAD")
+}
+
+/*
+** Once the headers are in, the declared body length is checked right away,
+** against the limit of the server the Host header selects, instead of
+** buffering the body first; before that only the header section itself is
+** bounded, counting just what parse() has scanned of the current request.
+** Pipelined bytes waiting behind a paused request are not part of it.
+*/
+bool WebServer::requestTooLarge(ClientConnection &conn)
+{
+	if (conn.request.headersComplete())
 	{
-		handleGetRequest(conn, request, location);
+		resolveServer(conn);
+		return (conn.request.getContentLength() > conn.server->_client_max_body_size);
 	}
-	else if (request.getMethod() == "POST")
+	return (conn.request.getHeaderBytes() > MAX_HEADER_SIZE);
+}
+
+/*
+** Points conn.server at the virtual host of the current request, once its
+** headers are in. Until then it still names the previous request's server
+** (or the listener's default), which error responses fall back on.
+*/
+void WebServer::resolveServer(ClientConnection &conn)
+{
+	if (conn.server_resolved)
 	{
-		handlePostRequest(conn, request, location);
+		return;
 	}
-	else if (request.getMethod() == "PUT")
+	conn.server = _vhosts.resolve(conn.listener, conn.request.getHeader(HttpRequest::HEADER_HOST));
+	conn.server_resolved = true;
+}
+
+/*
+** Indexed by HttpRequest::Method; NULL means the method is parsed but not
+** implemented.
+*/
+const WebServer::MethodHandler WebServer::METHOD_HANDLERS[HttpRequest::METHOD_COUNT] = {
+	&WebServer::handleGetRequest,
+	&WebServer::handlePostRequest,
+	&WebServer::handleDeleteRequest,
+	&WebServer::handlePutRequest,
+	&WebServer::handleGetRequest,
+	NULL
+};
+
+void WebServer::processRequest(ClientConnection &conn)
+{
+	const HttpRequest &request = conn.request;
+	HttpRequest::Method method = request.getMethodId();
+
+	resolveServer(conn);
+	std::cout << "📥 " << request.getMethod() << " " << request.getUri() << " from " << conn.client_ip << " (fd:" << conn.fd << ")"
+			  << " [Server: " << (conn.server->_server_names.empty() ? "default" : conn.server->_server_names[0]) << "]" << std::endl;
+	StringRef connection = request.getHeader(HttpRequest::HEADER_CONNECTION);
+	conn.keep_alive = (request.getVersion() == HttpRequest::HTTP_1_1 && !connection.equalsIgnoreCase("close")) || connection.equalsIgnoreCase("keep-alive");
+	if (request.getBody().size() > conn.server->_client_max_body_size)
 	{
-		handlePutRequest(conn, request, location);
+		sendErrorResponse(conn, 413, "Payload Too Large");
+		return;
 	}
-	else if (request.getMethod() == "DELETE")
+	const LocationConfig &location = conn.server->findLocationForRequest(request.getUri());
+	if (!(location._allowed_mask & (1u << method)))
 	{
-		handleDeleteRequest(conn, request, location);
+		sendErrorResponse(conn, 405, "Method Not Allowed");
+		return;
 	}
-	else
+	if (METHOD_HANDLERS[method] == NULL)
 	{
-		sendErrorResponse(conn.fd, 501, "Not Implemented", conn.server);
+		sendErrorResponse(conn, 501, "Not Implemented");
+		return;
 	}
+	(this->*METHOD_HANDLERS[method])(conn, request, location);
 }
 
 void WebServer::handleGetRequest(ClientConnection &conn,
 								 const HttpRequest &request, const LocationConfig &location)
 {
 	size_t query_pos;
-	HttpResponse response;
+	OpenFile *file;
+	OpenFile *index;
+	OpenFile *compressed;
+	const char *encoding;
+	bool conditional;
 
 	if (!location._redirect.empty())
 	{
-		sendRedirectResponse(conn.fd, 301, location._redirect);
+		sendRedirectResponse(conn, 301, location._redirect, &location);
 		return;
 	}
 	std::string file_path = location._root;
@@ -436,7 +661,7 @@ void WebServer::handleGetRequest(ClientConnection &conn,
 	{
 		file_path = "./www";
 	}
-	std::string uri = request.getUri();
+	std::string uri = request.getUri().str();
 	query_pos = uri.find('?');
 	if (query_pos != std::string::npos)
 	{
@@ -445,7 +670,7 @@ void WebServer::handleGetRequest(ClientConnection &conn,
 	uri = urlDecode(uri);
 	if (uri.find("../") != std::string::npos)
 	{
-		sendErrorResponse(conn.fd, 403, "Forbidden", conn.server);
+		sendErrorResponse(conn, 403, "Forbidden");
 		return;
 	}
 	if (location._path != "/" && uri.find(location._path) == 0)
@@ -457,54 +682,172 @@ void WebServer::handleGetRequest(ClientConnection &conn,
 		}
 	}
 	file_path += uri;
-	if (!location._cgi_extension.empty() && file_path.find(location._cgi_extension) != std::string::npos)
+	if (!location._cgi_extension.empty() && pathExtension(file_path) == location._cgi_extension)
 	{
 		handleCGIRequest(conn, request, location, file_path);
 		return;
 	}
-	if (!fileExists(file_path))
+	conditional = !request.getHeader(HttpRequest::HEADER_IF_NONE_MATCH).empty()
+		|| !request.getHeader(HttpRequest::HEADER_IF_MODIFIED_SINCE).empty();
+	file = _open_files.open(file_path, Clock::now(), !conditional);
+	if (file->err == ENOENT || file->err == ENOTDIR)
 	{
-		sendErrorResponse(conn.fd, 404, "Not Found", conn.server);
+		sendErrorResponse(conn, 404, "Not Found");
 		return;
 	}
-	if (isDirectory(file_path))
+	if (file->is_dir)
 	{
 		if (file_path[file_path.length() - 1] != '/')
 		{
-			sendRedirectResponse(conn.fd, 301, uri + "/");
+			sendRedirectResponse(conn, 301, uri + "/", &location);
 			return;
 		}
 		std::string index_path = file_path + location._index_file;
-		if (!location._index_file.empty() && fileExists(index_path))
+		index = NULL;
+		if (!location._index_file.empty())
+			index = _open_files.open(index_path, Clock::now(), !conditional);
+		if (index && index->err == 0 && !index->is_dir)
 		{
+			file = index;
 			file_path = index_path;
 		}
 		else if (location._directory_listing)
 		{
-			std::string listing = generateDirectoryListing(file_path, uri);
-			if (listing.empty())
-			{
-				sendErrorResponse(conn.fd, 403, "Forbidden", conn.server);
-				return;
-			}
-			response.setStatusCode(200);
-			response.setBody(listing);
-			response.addHeader("content-type", "text/html");
-			sendResponse(conn.fd, response);
+			sendDirectoryListing(conn, request, location, file_path, uri);
 			return;
 		}
 		else
 		{
-			sendErrorResponse(conn.fd, 403, "Forbidden", conn.server);
+			sendErrorResponse(conn, 403, "Forbidden");
 			return;
 		}
 	}
-	if (!isReadable(file_path))
+	if (file->err != 0)
+	{
+		sendErrorResponse(conn, 403, "Forbidden");
+		return;
+	}
+	encoding = NULL;
+	if (location._static_compressed)
+	{
+		compressed = openPrecompressed(request, file_path, &encoding,
+			!conditional);
+		if (compressed)
+			file = compressed;
+	}
+	serveStaticFile(conn, request, location, file, file_path, encoding);
+}
+
+/*
+** Autoindex from the cached snapshot of the directory. ?offset=&limit= pick a
+** page, and an Accept that weighs application/json above text/html asks for
+** JSON instead of HTML. A page with more than STREAM_LIMIT entries is not
+** built here: conn.listing renders it as the socket drains, compressed batch
+** by batch when negotiated. Its length is not known, so the page header, the
+** trailer and one byte per entry stand in for it against compress_min_length.
+** Validators come from the snapshot, so a 304 is only sent for the contents
+** the body would show.
+*/
+void WebServer::sendDirectoryListing(ClientConnection &conn,
+	const HttpRequest &request, const LocationConfig &location,
+	const std::string &dir_path, const std::string &uri)
+{
+	DirectorySnapshot *snapshot;
+	Compressor *compressor;
+	Compressor::Format format;
+	HttpResponse response;
+	StringRef target;
+	StringRef query;
+	std::string body;
+	std::string tail;
+	std::string etag;
+	const char *vary;
+	size_t first;
+	size_t last;
+	size_t limit;
+	bool head_only;
+	bool chunked;
+	bool json;
+
+	snapshot = _directories.get(dir_path, Clock::now());
+	if (!snapshot)
+	{
+		sendErrorResponse(conn, 403, "Forbidden");
+		return;
+	}
+	target = request.getUri();
+	for (size_t i = 0; i < target.length; i++)
+	{
+		if (target.data[i] == '?')
+		{
+			query = StringRef(target.data + i + 1, target.length - i - 1);
+			break;
+		}
+	}
+	DirectoryListing::parsePage(query, snapshot->size(), &first, &last, &limit);
+	json = mediaTypeQuality(request.getHeader("accept"), "application/json")
+		> mediaTypeQuality(request.getHeader("accept"), "text/html");
+	vary = location._compress ? "Accept, Accept-Encoding" : "Accept";
+	etag = listingTag(*snapshot, json);
+	if (notModified(request, etag, snapshot->mtime()))
 	{
-		sendErrorResponse(conn.fd, 403, "Forbidden", conn.server);
+		sendNotModified(conn, location, etag, snapshot->mtime(), vary);
+		return;
+	}
+	head_only = request.getMethodId() == HttpRequest::METHOD_HEAD;
+	response.setStatusCode(200);
+	response.addHeader("content-type", json ? "application/json" : "text/html");
+	response.addHeader("etag", etag);
+	response.addHeader("last-modified", formatHttpDate(snapshot->mtime()));
+	addCacheHeaders(response, location);
+	DirectoryListing::renderHead(body, uri, json);
+	DirectoryListing::renderTail(tail, json, first, limit, snapshot->size());
+	if (last - first > DirectoryListing::STREAM_LIMIT)
+	{
+		response.addHeader("vary", vary);
+		compressor = NULL;
+		if (negotiateCompression(request, location, *response.getHeader("content-type"),
+				body.size() + tail.size() + (last - first), &format))
+		{
+			compressor = new Compressor(format, location._compress_level, 0);
+			if (compressor->ok())
+				response.addHeader("content-encoding", Compressor::encodingName(format));
+			else
+			{
+				delete compressor;
+				compressor = NULL;
+			}
+		}
+		chunked = request.getVersion() == HttpRequest::HTTP_1_1;
+		if (chunked)
+			response.addHeader("transfer-encoding", "chunked");
+		else
+		{
+			conn.keep_alive = false;
+			response.setCloseDelimited(true);
+		}
+		sendResponse(conn, response);
+		if (head_only)
+			delete compressor;
+		else
+			conn.listing.start(snapshot, first, last, json, chunked, compressor,
+				body, tail);
 		return;
 	}
-	serveStaticFile(conn.fd, file_path, request.getMethod() == "HEAD");
+	if (!json && first == 0 && last == snapshot->size())
+		body += snapshot->htmlRows();
+	else
+		snapshot->render(body, first, last, json, first);
+	body += tail;
+	response.setBody(body);
+	compressResponse(request, location, response);
+	response.addHeader("vary", vary);
+	if (head_only)
+	{
+		response.addHeader("content-length", toString(response.getBody().size()));
+		response.setBody("");
+	}
+	sendResponse(conn, response);
 }
 
 void WebServer::handlePostRequest(ClientConnection &conn,
@@ -512,7 +855,7 @@ void WebServer::handlePostRequest(ClientConnection &conn,
 {
 	size_t query_pos;
 
-	std::string uri = request.getUri();
+	std::string uri = request.getUri().str();
 	query_pos = uri.find('?');
 	if (query_pos != std::string::npos)
 	{
@@ -532,7 +875,7 @@ void WebServer::handlePostRequest(ClientConnection &conn,
 		}
 	}
 	file_path += uri;
-	if (!location._cgi_extension.empty() && file_path.find(location._cgi_extension) != std::string::npos)
+	if (!location._cgi_extension.empty() && pathExtension(file_path) == location._cgi_extension)
 	{
 		handleCGIRequest(conn, request, location, file_path);
 		return;
@@ -542,7 +885,7 @@ void WebServer::handlePostRequest(ClientConnection &conn,
 		handleFileUpload(conn, request, location);
 		return;
 	}
-	sendErrorResponse(conn.fd, 405, "Method Not Allowed", conn.server);
+	sendErrorResponse(conn, 405, "Method Not Allowed");
 }
 
 void WebServer::handlePutRequest(ClientConnection &conn,
@@ -556,10 +899,10 @@ void WebServer::handlePutRequest(ClientConnection &conn,
 	{
 		file_path = "./www";
 	}
-	std::string uri = urlDecode(request.getUri());
+	std::string uri = urlDecode(request.getUri().str());
 	if (uri.find("../") != std::string::npos)
 	{
-		sendErrorResponse(conn.fd, 403, "Forbidden", conn.server);
+		sendErrorResponse(conn, 403, "Forbidden");
 		return;
 	}
 	if (location._path != "/" && uri.find(location._path) == 0)
@@ -574,23 +917,24 @@ void WebServer::handlePutRequest(ClientConnection &conn,
 	std::string dir_path = file_path.substr(0, file_path.find_last_of('/'));
 	if (!fileExists(dir_path))
 	{
-		sendErrorResponse(conn.fd, 404, "Not Found", conn.server);
+		sendErrorResponse(conn, 404, "Not Found");
 		return;
 	}
 	file_existed = fileExists(file_path);
-	if (writeFile(file_path, request.getBody()))
+	if (writeFile(file_path, request.getBody().data, request.getBody().length))
 	{
+		_open_files.invalidate(file_path);
 		response.setStatusCode(file_existed ? 204 : 201);
 		if (!file_existed)
 		{
-			response.addHeader("location", request.getUri());
+			response.addHeader("location", request.getUri().str());
 		}
-		sendResponse(conn.fd, response);
+		sendResponse(conn, response);
 		std::cout << "📝 PUT file: " << file_path << " (" << (file_existed ? "updated" : "created") << ")" << std::endl;
 	}
 	else
 	{
-		sendErrorResponse(conn.fd, 500, "Internal Server Error", conn.server);
+		sendErrorResponse(conn, 500, "Internal Server Error");
 	}
 }
 
@@ -604,10 +948,10 @@ void WebServer::handleDeleteRequest(ClientConnection &conn,
 	{
 		file_path = "./www";
 	}
-	std::string uri = urlDecode(request.getUri());
+	std::string uri = urlDecode(request.getUri().str());
 	if (uri.find("../") != std::string::npos)
 	{
-		sendErrorResponse(conn.fd, 403, "Forbidden", conn.server);
+		sendErrorResponse(conn, 403, "Forbidden");
 		return;
 	}
 	if (location._path != "/" && uri.find(location._path) == 0)
@@ -621,28 +965,29 @@ void WebServer::handleDeleteRequest(ClientConnection &conn,
 	file_path += uri;
 	if (!fileExists(file_path))
 	{
-		sendErrorResponse(conn.fd, 404, "Not Found", conn.server);
+		sendErrorResponse(conn, 404, "Not Found");
 		return;
 	}
 	if (isDirectory(file_path))
 	{
-		sendErrorResponse(conn.fd, 403, "Forbidden", conn.server);
+		sendErrorResponse(conn, 403, "Forbidden");
 		return;
 	}
 	if (!isWritable(file_path))
 	{
-		sendErrorResponse(conn.fd, 403, "Forbidden", conn.server);
+		sendErrorResponse(conn, 403, "Forbidden");
 		return;
 	}
 	if (unlink(file_path.c_str()) == 0)
 	{
+		_open_files.invalidate(file_path);
 		response.setStatusCode(204);
-		sendResponse(conn.fd, response);
+		sendResponse(conn, response);
 		std::cout << "🗑️  Deleted: " << file_path << std::endl;
 	}
 	else
 	{
-		sendErrorResponse(conn.fd, 500, "Internal Server Error", conn.server);
+		sendErrorResponse(conn, 500, "Internal Server Error");
 	}
 }
 
@@ -653,22 +998,23 @@ void WebServer::handleCGIRequest(ClientConnection &conn,
 	std::cout << "🔧 Executing CGI: " << script_path << std::endl;
 	if (!fileExists(script_path))
 	{
-		sendErrorResponse(conn.fd, 404, "Not Found", conn.server);
+		sendErrorResponse(conn, 404, "Not Found");
 		return;
 	}
 	if (!isExecutable(script_path))
 	{
-		sendErrorResponse(conn.fd, 403, "Forbidden", conn.server);
+		sendErrorResponse(conn, 403, "Forbidden");
 		return;
 	}
 	CGI cgi(request, location);
 	std::string response = cgi.execute(script_path);
+	Clock::update();
 	if (response.empty())
 	{
-		sendErrorResponse(conn.fd, 500, "Internal Server Error", conn.server);
+		sendErrorResponse(conn, 500, "Internal Server Error");
 		return;
 	}
-	send(conn.fd, response.c_str(), response.length(), 0);
+	sendRawResponse(conn, request, location, response);
 }
 
 void WebServer::handleFileUpload(ClientConnection &conn,
@@ -678,8 +1024,8 @@ void WebServer::handleFileUpload(ClientConnection &conn,
 	size_t end;
 	HttpResponse response;
 
-	std::string filename = "upload_" + toString(time(NULL));
-	std::string content_disp = request.getHeader("content-disposition");
+	std::string filename = "upload_" + toString(Clock::now());
+	std::string content_disp = request.getHeader("content-disposition").str();
 	if (!content_disp.empty())
 	{
 		pos = content_disp.find("filename=");
@@ -709,133 +1055,624 @@ void WebServer::handleFileUpload(ClientConnection &conn,
 		upload_path += '/';
 	}
 	upload_path += filename;
-	if (writeFile(upload_path, request.getBody()))
+	if (writeFile(upload_path, request.getBody().data, request.getBody().length))
 	{
+		_open_files.invalidate(upload_path);
 		response.setStatusCode(201);
 		response.addHeader("location", "/" + upload_path);
 		response.setBody("File uploaded successfully: " + filename);
 		response.addHeader("content-type", "text/plain");
-		sendResponse(conn.fd, response);
+		sendResponse(conn, response);
 		std::cout << "📤 File uploaded: " << upload_path << std::endl;
 	}
 	else
 	{
-		sendErrorResponse(conn.fd, 500, "Failed to save file", conn.server);
+		sendErrorResponse(conn, 500, "Failed to save file");
 	}
 }
 
-void WebServer::serveStaticFile(int client_fd, const std::string &file_path,
-								bool head_only)
+/*
+** Looks for a .br or .gz sibling of file_path that the client accepts, brotli
+** first. Missing siblings are negative entries in the open file cache, so the
+** lookup costs nothing once warm.
+*/
+OpenFile *WebServer::openPrecompressed(const HttpRequest &request,
+	const std::string &file_path, const char **encoding, bool need_fd)
+{
+	static const char *const codings[][2] = {{"br", ".br"}, {"gzip", ".gz"}};
+	StringRef accept;
+	OpenFile *sibling;
+
+	accept = request.getHeader(HttpRequest::HEADER_ACCEPT_ENCODING);
+	if (accept.empty())
+		return (NULL);
+	for (size_t i = 0; i < sizeof(codings) / sizeof(codings[0]); i++)
+	{
+		if (!acceptsEncoding(accept, codings[i][0]))
+			continue;
+		sibling = _open_files.open(file_path + codings[i][1], Clock::now(), need_fd);
+		if (sibling->err == 0 && !sibling->is_dir)
+		{
+			*encoding = codings[i][0];
+			return (sibling);
+		}
+	}
+	return (NULL);
+}
+
+/*
+** Small hot files are answered from the content cache with shared, fully
+** serialized buffers. Anything else gets its header built here and its body
+** queued as a range of the (possibly cached) open file, streamed with
+** sendfile() as the socket drains, so memory use does not depend on the file
+** size.
+**
+** file may be a precompressed sibling of file_path; the MIME type always comes
+** from file_path and encoding names the Content-Encoding, if any.
+*/
+void WebServer::serveStaticFile(ClientConnection &conn,
+								const HttpRequest &request, const LocationConfig &location,
+								OpenFile *file, const std::string &file_path,
+								const char *encoding)
 {
 	HttpResponse response;
+	const CachedContent *cached;
+	std::string variant;
+	StringRef range;
+	bool head_only;
+	bool vary;
 
-	std::string content = readFile(file_path);
-	if (content.empty() && getFileSize(file_path) > 0)
+	vary = location._static_compressed;
+	head_only = request.getMethodId() == HttpRequest::METHOD_HEAD;
+	if ((!request.getHeader(HttpRequest::HEADER_IF_NONE_MATCH).empty()
+			|| !request.getHeader(HttpRequest::HEADER_IF_MODIFIED_SINCE).empty())
+		&& notModified(request, entityTag(*file), file->mtime))
+	{
+		sendNotModified(conn, location, entityTag(*file), file->mtime,
+			vary ? "Accept-Encoding" : NULL);
+		return;
+	}
+	if (file->fd < 0)
 	{
-		sendErrorResponse(client_fd, 500, "Failed to read file");
+		file = _open_files.open(std::string(file->path), Clock::now());
+		if (file->fd < 0)
+		{
+			sendErrorResponse(conn, 404, "Not Found");
+			return;
+		}
+	}
+	range = request.getHeader(HttpRequest::HEADER_RANGE);
+	if (!range.empty() && rangeStillValid(request, *file))
+	{
+		RangeResult result = parseByteRanges(range, file->size, _ranges, MAX_RANGES);
+		if (result != RANGE_NONE)
+		{
+			serveRanges(conn, location, file, file_path, encoding,
+				result == RANGE_OK, head_only);
+			return;
+		}
+	}
+	if (encoding)
+		variant = encoding;
+	if (vary)
+		variant += "+vary";
+	cached = _content_cache.find(file->path, variant, *file);
+	if (!cached)
+	{
+		response.setStatusCode(200);
+		response.addHeader("content-type", _mime_types.lookup(file_path));
+		response.addHeader("content-length", toString(file->size));
+		response.addHeader("accept-ranges", "bytes");
+		addValidators(response, *file);
+		if (encoding)
+			response.addHeader("content-encoding", encoding);
+		if (vary)
+			response.addHeader("vary", "Accept-Encoding");
+		cached = _content_cache.insert(file->path, variant, *file, response);
+	}
+	if (cached)
+	{
+		conn.header_buffer = Clock::dateHeader();
+		appendCacheHeaders(conn.header_buffer, location);
+		conn.header_buffer += "\r\n";
+		conn.output.appendShared(cached->header[conn.keep_alive ? 1 : 0]);
+		conn.output.append(conn.header_buffer);
+		if (!head_only)
+			conn.output.appendShared(cached->body);
 		return;
 	}
-	response.setStatusCode(200);
+	addCacheHeaders(response, location);
+	sendResponse(conn, response);
 	if (!head_only)
+		conn.output.appendFile(file, 0, file->size);
+}
+
+/*
+** If-Range makes the Range conditional on the client's copy still being
+** current; a stale validator means the whole file is sent instead.
+*/
+bool WebServer::rangeStillValid(const HttpRequest &request,
+	const OpenFile &file) const
+{
+	StringRef validator;
+
+	validator = request.getHeader(HttpRequest::HEADER_IF_RANGE);
+	if (validator.empty())
+		return (true);
+	if (validator.data[0] == '"')
+		return (validator == entityTag(file).c_str());
+	return (validator == formatHttpDate(file.mtime).c_str());
+}
+
+/*
+** If-None-Match takes precedence; ETags are compared weakly, as RFC 9110
+** requires for GET. If-Modified-Since must match Last-Modified exactly, like
+** nginx's default, which avoids parsing dates and clock-skew surprises.
+*/
+bool WebServer::notModified(const HttpRequest &request,
+	const std::string &etag, time_t mtime) const
+{
+	StringRef header;
+	StringRef candidate;
+	StringRef current;
+	size_t start;
+	size_t end;
+
+	header = request.getHeader(HttpRequest::HEADER_IF_NONE_MATCH);
+	if (!header.empty())
 	{
-		response.setBody(content);
+		current = StringRef(etag);
+		if (current.length > 2 && current.data[0] == 'W')
+			current = StringRef(current.data + 2, current.length - 2);
+		for (start = 0; start < header.length; start = end + 1)
+		{
+			end = start;
+			while (end < header.length && header.data[end] != ',')
+				end++;
+			while (start < end && (header.data[start] == ' ' || header.data[start] == '\t'))
+				start++;
+			candidate = StringRef(header.data + start, end - start);
+			while (candidate.length > 0 && (candidate.data[candidate.length - 1] == ' '
+					|| candidate.data[candidate.length - 1] == '\t'))
+				candidate.length--;
+			if (candidate == "*")
+				return (true);
+			if (candidate.length > 2 && candidate.data[0] == 'W' && candidate.data[1] == '/')
+				candidate = StringRef(candidate.data + 2, candidate.length - 2);
+			if (candidate == current)
+				return (true);
+		}
+		return (false);
 	}
-	response.addHeader("content-type", getMimeType(file_path));
-	response.addHeader("content-length", toString(content.length()));
-	sendResponse(client_fd, response);
+	header = request.getHeader(HttpRequest::HEADER_IF_MODIFIED_SINCE);
+	return (!header.empty() && header == formatHttpDate(mtime).c_str());
 }
 
-void WebServer::sendResponse(int client_fd, const HttpResponse &response)
+/*
+** A 304 carries only the headers a cache refreshes its stored response from:
+** validators, Date, Cache-Control/Expires and Vary. No Content-Type or
+** Content-Length, which would overwrite the stored ones. vary is the Vary
+** value of the 200 it stands for, or NULL when that has none.
+*/
+void WebServer::sendNotModified(ClientConnection &conn,
+	const LocationConfig &location, const std::string &etag, time_t mtime,
+	const char *vary)
 {
-	ssize_t sent;
+	HttpResponse response;
+
+	response.setStatusCode(304);
+	response.removeHeader("content-type");
+	response.addHeader("etag", etag);
+	response.addHeader("last-modified", formatHttpDate(mtime));
+	if (vary)
+		response.addHeader("vary", vary);
+	addCacheHeaders(response, location);
+	sendResponse(conn, response);
+}
+
+/*
+** Cache-Control is precomputed per location at config load; only a relative
+** Expires needs the clock.
+*/
+void WebServer::addCacheHeaders(HttpResponse &response,
+	const LocationConfig &location)
+{
+	if (!location._cache_control_header.empty())
+		response.addHeader("cache-control", location._cache_control_header);
+	if (location._expires_mode == LocationConfig::EXPIRES_FIXED)
+		response.addHeader("expires", location._expires_header);
+	else if (location._expires_mode == LocationConfig::EXPIRES_RELATIVE)
+		response.addHeader("expires", formatHttpDate(Clock::now() + location._expires));
+}
+
+/*
+** Same headers, appended as raw lines after a pre-serialized header block.
+*/
+void WebServer::appendCacheHeaders(std::string &block,
+	const LocationConfig &location)
+{
+	if (!location._cache_control_header.empty())
+		block += "cache-control: " + location._cache_control_header + "\r\n";
+	if (location._expires_mode == LocationConfig::EXPIRES_FIXED)
+		block += "expires: " + location._expires_header + "\r\n";
+	else if (location._expires_mode == LocationConfig::EXPIRES_RELATIVE)
+		block += "expires: " + formatHttpDate(Clock::now() + location._expires) + "\r\n";
+}
 
-	std::string data = response.serialize();
-	sent = send(client_fd, data.c_str(), data.length(), 0);
-	if (sent < 0)
+/*
+** 206 for the ranges left in _ranges, or 416 when none was satisfiable. Every
+** range is queued as an offset into the open file, so sendfile() reads exactly
+** the requested bytes; several ranges become a multipart/byteranges body whose
+** part headers sit between the file segments.
+*/
+void WebServer::serveRanges(ClientConnection &conn,
+	const LocationConfig &location, OpenFile *file,
+	const std::string &file_path, const char *encoding, bool satisfiable,
+	bool head_only)
+{
+	static unsigned long boundary_sequence = Clock::now();
+	std::vector<std::string> part_headers;
+	std::string content_type;
+	std::string boundary;
+	std::string trailer;
+	HttpResponse response;
+	char buffer[32];
+	off_t length;
+
+	response.addHeader("accept-ranges", "bytes");
+	addValidators(response, *file);
+	addCacheHeaders(response, location);
+	if (encoding)
+		response.addHeader("content-encoding", encoding);
+	if (location._static_compressed)
+		response.addHeader("vary", "Accept-Encoding");
+	if (!satisfiable)
+	{
+		response.setStatusCode(416);
+		response.addHeader("content-range", "bytes */" + toString(file->size));
+		sendResponse(conn, response);
+		return;
+	}
+	response.setStatusCode(206);
+	content_type = _mime_types.lookup(file_path);
+	if (_ranges.size() == 1)
+	{
+		length = _ranges[0].last - _ranges[0].first + 1;
+		response.addHeader("content-type", content_type);
+		response.addHeader("content-range", "bytes " + toString(_ranges[0].first)
+			+ "-" + toString(_ranges[0].last) + "/" + toString(file->size));
+		response.addHeader("content-length", toString(length));
+		sendResponse(conn, response);
+		if (!head_only)
+			conn.output.appendFile(file, _ranges[0].first, length);
+		return;
+	}
+	snprintf(buffer, sizeof(buffer), "%020lu", ++boundary_sequence);
+	boundary = buffer;
+	length = 0;
+	for (size_t i = 0; i < _ranges.size(); i++)
+	{
+		part_headers.push_back("\r\n--" + boundary + "\r\ncontent-type: "
+			+ content_type + "\r\ncontent-range: bytes "
+			+ toString(_ranges[i].first) + "-" + toString(_ranges[i].last)
+			+ "/" + toString(file->size) + "\r\n\r\n");
+		length += part_headers[i].size() + _ranges[i].last - _ranges[i].first + 1;
+	}
+	trailer = "\r\n--" + boundary + "--\r\n";
+	length += trailer.size();
+	response.addHeader("content-type", "multipart/byteranges; boundary=" + boundary);
+	response.addHeader("content-length", toString(length));
+	sendResponse(conn, response);
+	if (head_only)
+		return;
+	for (size_t i = 0; i < _ranges.size(); i++)
 	{
-		std::cerr << "Error sending response" << std::endl;
+		conn.output.append(part_headers[i]);
+		conn.output.appendFile(file, _ranges[i].first,
+			_ranges[i].last - _ranges[i].first + 1);
 	}
+	conn.output.append(trailer);
 }
 
-void WebServer::sendErrorResponse(int client_fd, int code,
-								  const std::string &message, const ServerConfig *server)
+/*
+** Decides whether a generated body should be compressed: the location must
+** have `compress on`, the MIME type must be listed in compress_types (or "*")
+** and not be an already-compressed format, the body must reach
+** compress_min_length, and the client must accept gzip or deflate.
+*/
+bool WebServer::negotiateCompression(const HttpRequest &request,
+	const LocationConfig &location, const std::string &content_type,
+	size_t length, Compressor::Format *format) const
 {
-	HttpResponse response;
+	StringRef accept;
+	std::string mime;
+	bool listed;
+
+	if (!location._compress || length < location._compress_min_length)
+		return (false);
+	mime = toLowerCase(trim(content_type.substr(0, content_type.find(';'))));
+	if (isCompressedMimeType(mime))
+		return (false);
+	listed = false;
+	for (size_t i = 0; i < location._compress_types.size() && !listed; i++)
+		listed = location._compress_types[i] == "*" || location._compress_types[i] == mime;
+	if (!listed)
+		return (false);
+	accept = request.getHeader(HttpRequest::HEADER_ACCEPT_ENCODING);
+	if (acceptsEncoding(accept, "gzip"))
+		*format = Compressor::FORMAT_GZIP;
+	else if (acceptsEncoding(accept, "deflate"))
+		*format = Compressor::FORMAT_DEFLATE;
+	else
+		return (false);
+	return (true);
+}
+
+void WebServer::compressResponse(const HttpRequest &request,
+	const LocationConfig &location, HttpResponse &response)
+{
+	const std::string *type;
+	Compressor::Format format;
+	std::string compressed;
+
+	if (location._compress)
+		response.addHeader("vary", "Accept-Encoding");
+	type = response.getHeader("content-type");
+	if (type == NULL || response.getHeader("content-encoding") != NULL
+		|| !negotiateCompression(request, location, *type,
+			response.getBody().size(), &format))
+		return;
+	if (!Compressor::compress(format, location._compress_level,
+			response.getBody().data(), response.getBody().size(), compressed))
+		return;
+	response.swapBody(compressed);
+	response.addHeader("content-encoding", Compressor::encodingName(format));
+	if (response.getHeader("content-length") != NULL)
+		response.addHeader("content-length", toString(response.getBody().size()));
+}
 
-	if (server)
+/*
+** Queues CGI output, which arrives as a complete HTTP message, compressing
+** its body when negotiated. The header block is kept as written by the
+** script except for Content-Length, which is recomputed. The body is
+** deflated straight out of response and both strings are handed to the
+** output queue, so nothing is copied on the way.
+*/
+void WebServer::sendRawResponse(ClientConnection &conn,
+	const HttpRequest &request, const LocationConfig &location,
+	std::string &response)
+{
+	std::vector<std::string> lines;
+	Compressor::Format format;
+	std::string content_type;
+	std::string compressed;
+	std::string head;
+	size_t separator;
+	size_t colon;
+
+	separator = response.find("\r\n\r\n");
+	if (separator == std::string::npos)
+	{
+		conn.output.appendOwned(response);
+		return;
+	}
+	lines = split(response.substr(0, separator), '\n');
+	for (size_t i = 0; i < lines.size(); i++)
 	{
-		std::map<int,
-				 std::string>::const_iterator it = server->_error_pages.find(code);
-		if (it != server->_error_pages.end())
+		colon = lines[i].find(':');
+		if (colon == std::string::npos)
+			continue;
+		std::string name = toLowerCase(trim(lines[i].substr(0, colon)));
+		if (name == "content-encoding" || name == "transfer-encoding")
 		{
-			std::string error_page = readFile(it->second);
-			if (!error_page.empty())
-			{
-				response.setStatusCode(code);
-				response.setBody(error_page);
-				response.addHeader("content-type", "text/html");
-				sendResponse(client_fd, response);
-				return;
-			}
+			conn.output.appendOwned(response);
+			return;
 		}
+		if (name == "content-type")
+			content_type = trim(lines[i].substr(colon + 1));
+	}
+	if (content_type.empty()
+		|| !negotiateCompression(request, location, content_type,
+			response.size() - separator - 4, &format)
+		|| !Compressor::compress(format, location._compress_level,
+			response.data() + separator + 4, response.size() - separator - 4,
+			compressed))
+	{
+		if (location._compress)
+			response.insert(separator + 2, "Vary: Accept-Encoding\r\n");
+		conn.output.appendOwned(response);
+		return;
+	}
+	for (size_t i = 0; i < lines.size(); i++)
+	{
+		std::string line = trim(lines[i]);
+		colon = line.find(':');
+		if (colon != std::string::npos
+			&& toLowerCase(trim(line.substr(0, colon))) == "content-length")
+			continue;
+		head += line + "\r\n";
+	}
+	head += "Content-Encoding: ";
+	head += Compressor::encodingName(format);
+	head += "\r\nVary: Accept-Encoding\r\nContent-Length: ";
+	head += toString(compressed.size());
+	head += "\r\n\r\n";
+	conn.output.appendOwned(head);
+	conn.output.appendOwned(compressed);
+}
+
+void WebServer::sendResponse(ClientConnection &conn, HttpResponse &response)
+{
+	std::string body;
+
+	response.setConnectionType(conn.keep_alive ? "keep-alive" : "close");
+	conn.header_buffer.clear();
+	response.serializeHeader(conn.header_buffer);
+	conn.output.append(conn.header_buffer);
+	response.swapBody(body);
+	conn.output.appendOwned(body);
+}
+
+/*
+** Error responses are prepared at startup (see ErrorPages), so the common
+** case queues the shared header, a Date line and the shared body. Only a
+** built-in page asked for with a non-standard message is generated here.
+** A HEAD request gets the header alone, with the body's Content-Length.
+*/
+void WebServer::sendErrorResponse(ClientConnection &conn, int code,
+								  const std::string &message)
+{
+	const ErrorPage *page;
+	HttpResponse response;
+	bool head_only;
+
+	head_only = conn.request.getMethodId() == HttpRequest::METHOD_HEAD;
+	page = _error_pages.find(conn.server - &_servers[0], code);
+	if (page && (page->custom || HttpResponse::reasonPhrase(code) == message.c_str()))
+	{
+		conn.header_buffer = Clock::dateHeader();
+		conn.header_buffer += "\r\n";
+		conn.output.appendShared(page->header[conn.keep_alive ? 1 : 0]);
+		conn.output.append(conn.header_buffer);
+		if (!head_only)
+			conn.output.appendShared(page->body);
+		return;
 	}
 	response.setError(code, message);
-	sendResponse(client_fd, response);
+	if (head_only)
+	{
+		response.addHeader("content-length", toString(response.getBody().size()));
+		response.setBody("");
+	}
+	sendResponse(conn, response);
 }
 
-void WebServer::sendRedirectResponse(int client_fd, int code,
-									 const std::string &location)
+void WebServer::sendRedirectResponse(ClientConnection &conn, int code,
+									 const std::string &target,
+									 const LocationConfig *location)
 {
 	HttpResponse response;
 
 	response.setStatusCode(code);
-	response.addHeader("location", location);
+	response.addHeader("location", target);
 	std::string body = "<!DOCTYPE html><html><head><title>Redirect</title></head>"
 					   "<body><h1>Redirecting...</h1><p>Redirecting to "
 					   "<a href=\"" +
-					   location + "\">" + location + "</a></p></body></html>";
+					   target + "\">" + target + "</a></p></body></html>";
 	response.setBody(body);
 	response.addHeader("content-type", "text/html");
-	sendResponse(client_fd, response);
+	if (location)
+		addCacheHeaders(response, *location);
+	sendResponse(conn, response);
 }
 
-void WebServer::removeClient(int client_fd)
+void WebServer::handleClientWrite(int client_fd)
 {
-	g_clients.erase(client_fd);
-	close(client_fd);
-	for (std::vector<struct pollfd>::iterator it = _poll_fds.begin(); it != _poll_fds.end(); ++it)
+	ClientConnection *conn = _clients.find(client_fd);
+	if (!conn)
 	{
-		if (it->fd == client_fd)
-		{
-			_poll_fds.erase(it);
-			break;
-		}
+		return;
+	}
+	_timers.schedule(client_fd, Clock::now() + TIMEOUT_SECONDS);
+	if (flushClient(*conn) && conn->output.empty()
+		&& (!conn->buffer.empty() || conn->input_pending))
+	{
+		serviceRequests(*conn);
 	}
 }
 
-void WebServer::checkTimeouts()
+/*
+** Writes as much of the output queue as the socket takes. While bytes are
+** pending the client only waits for writability; once drained it either goes
+** back to reading or is closed. A streamed directory listing is refilled
+** each time the queue drains, until the socket would block or the listing
+** ends. Returns false when the client was removed.
+*/
+bool WebServer::flushClient(ClientConnection &conn)
 {
-	time_t now;
+	FlushResult result;
 
-	now = time(NULL);
-	std::vector<int> to_remove;
-	for (std::map<int,
-				  ClientConnection>::iterator it = g_clients.begin();
-		 it != g_clients.end(); ++it)
+	result = conn.output.flush(conn.fd);
+	while (result == FLUSH_DONE && conn.listing.active())
 	{
-		if (now - it->second.last_activity > TIMEOUT_SECONDS)
-		{
-			to_remove.push_back(it->first);
-		}
+		if (!conn.listing.pump(conn.output))
+			result = FLUSH_ERROR;
+		else
+			result = conn.output.flush(conn.fd);
 	}
-	for (size_t i = 0; i < to_remove.size(); ++i)
+	if (result == FLUSH_ERROR)
 	{
-		std::cout << "⏱️  Timeout: closing connection " << to_remove[i] << std::endl;
-		removeClient(to_remove[i]);
+		removeClient(conn.fd);
+		return (false);
 	}
+	if (result == FLUSH_AGAIN)
+	{
+		_poller->modify(conn.fd, POLLER_OUT);
+		return (true);
+	}
+	if (conn.close_after_write)
+	{
+		removeClient(conn.fd);
+		return (false);
+	}
+	_poller->modify(conn.fd, POLLER_IN);
+	return (true);
+}
+
+void WebServer::removeClient(int client_fd)
+{
+	_clients.release(client_fd);
+	_timers.cancel(client_fd);
+	_poller->remove(client_fd);
+	close(client_fd);
+}
+
+void WebServer::checkTimeouts()
+{
+	_timers.expire(Clock::now(), _expired);
+	for (size_t i = 0; i < _expired.size(); ++i)
+	{
+		std::cout << "⏱️  Timeout: closing connection " << _expired[i] << std::endl;
+		removeClient(_expired[i]);
+	}
+}
+
+/*
+** ETags are built from inode, size and mtime, so any change to the file, or
+** its replacement by another one, yields a new tag.
+*/
+std::string WebServer::entityTag(const OpenFile &file)
+{
+	char buffer[80];
+
+	snprintf(buffer, sizeof(buffer), "\"%lx-%lx-%lx\"",
+		static_cast<unsigned long>(file.inode),
+		static_cast<unsigned long>(file.size),
+		static_cast<unsigned long>(file.mtime));
+	return (buffer);
+}
+
+/*
+** Listing tags are weak, and name the representation: the HTML and JSON
+** pages of one snapshot are different bodies.
+*/
+std::string WebServer::listingTag(const DirectorySnapshot &dir, bool json)
+{
+	char buffer[80];
+
+	snprintf(buffer, sizeof(buffer), "W/\"%x-%lx-%lx-%s\"", dir.digest(),
+		static_cast<unsigned long>(dir.size()),
+		static_cast<unsigned long>(dir.mtime()), json ? "json" : "html");
+	return (buffer);
+}
+
+void WebServer::addValidators(HttpResponse &response, const OpenFile &file)
+{
+	response.addHeader("etag", entityTag(file));
+	response.addHeader("last-modified", formatHttpDate(file.mtime));
 }
 
-std::string WebServer::toString(int num)
+std::string WebServer::toString(long num)
 {
 	std::ostringstream oss;
 	oss << num;
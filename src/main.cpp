@@ -155,7 +155,7 @@ int main(int argc, char *argv[])
 
 		printServerInfo(servers);
 
-		WebServer server(servers);
+		WebServer server(config);
 		server.run();
 	}
 	catch (const std::exception &e)
@@ -12,7 +12,6 @@
 
 #include "../inc/utils.hpp"
 #include <sys/stat.h>
-#include <dirent.h>
 #include <fstream>
 #include <sstream>
 #include <algorithm>
@@ -20,6 +19,7 @@
 #include <ctime>
 #include <unistd.h>
 #include <iomanip>
+#include <cstdlib>
 
 bool isDirectory(const std::string &path)
 {
@@ -87,6 +87,11 @@ std::string readFile(const std::string &path)
 }
 
 bool writeFile(const std::string &path, const std::string &content)
+{
+    return writeFile(path, content.data(), content.length());
+}
+
+bool writeFile(const std::string &path, const char *data, size_t length)
 {
     std::ofstream file(path.c_str(), std::ios::binary);
     if (!file.is_open())
@@ -94,127 +99,12 @@ bool writeFile(const std::string &path, const std::string &content)
         return false;
     }
 
-    file << content;
+    file.write(data, length);
     file.close();
 
     return true;
 }
 
-std::string generateDirectoryListing(const std::string &path, const std::string &uri)
-{
-    DIR *dir = opendir(path.c_str());
-    if (!dir)
-    {
-        return "";
-    }
-
-    std::ostringstream html;
-    html << "<!DOCTYPE html>\n";
-    html << "<html>\n";
-    html << "<head>\n";
-    html << "  <title>Index of " << uri << "</title>\n";
-    html << "  <style>\n";
-    html << "    body { font-family: monospace; margin: 20px; }\n";
-    html << "    h1 { font-size: 24px; }\n";
-    html << "    table { border-collapse: collapse; width: 100%; }\n";
-    html << "    th, td { padding: 8px 15px; text-align: left; }\n";
-    html << "    th { background-color: #f0f0f0; border-bottom: 2px solid #ddd; }\n";
-    html << "    tr:hover { background-color: #f5f5f5; }\n";
-    html << "    a { text-decoration: none; color: #0066cc; }\n";
-    html << "    a:hover { text-decoration: underline; }\n";
-    html << "    .dir { font-weight: bold; }\n";
-    html << "    .size { text-align: right; font-family: monospace; }\n";
-    html << "    .date { font-family: monospace; }\n";
-    html << "  </style>\n";
-    html << "</head>\n";
-    html << "<body>\n";
-    html << "  <h1>Index of " << uri << "</h1>\n";
-    html << "  <hr>\n";
-    html << "  <table>\n";
-    html << "    <thead>\n";
-    html << "      <tr>\n";
-    html << "        <th>Name</th>\n";
-    html << "        <th>Size</th>\n";
-    html << "        <th>Last Modified</th>\n";
-    html << "      </tr>\n";
-    html << "    </thead>\n";
-    html << "    <tbody>\n";
-
-    if (uri != "/")
-    {
-        html << "      <tr>\n";
-        html << "        <td><a href=\"../\" class=\"dir\">../</a></td>\n";
-        html << "        <td class=\"size\">-</td>\n";
-        html << "        <td class=\"date\">-</td>\n";
-        html << "      </tr>\n";
-    }
-
-    struct dirent *entry;
-    std::vector<std::string> entries;
-
-    while ((entry = readdir(dir)) != NULL)
-    {
-        std::string name = entry->d_name;
-
-        if (name[0] == '.')
-        {
-            continue;
-        }
-
-        entries.push_back(name);
-    }
-    closedir(dir);
-
-    std::sort(entries.begin(), entries.end());
-
-    for (std::vector<std::string>::const_iterator it = entries.begin();
-         it != entries.end(); ++it)
-    {
-
-        std::string entry_path = path + "/" + *it;
-        struct stat info;
-
-        if (stat(entry_path.c_str(), &info) == 0)
-        {
-            html << "      <tr>\n";
-
-            html << "        <td>";
-            if (S_ISDIR(info.st_mode))
-            {
-                html << "<a href=\"" << *it << "/\" class=\"dir\">" << *it << "/</a>";
-            }
-            else
-            {
-                html << "<a href=\"" << *it << "\">" << *it << "</a>";
-            }
-            html << "</td>\n";
-
-            html << "        <td class=\"size\">";
-            if (S_ISDIR(info.st_mode))
-            {
-                html << "-";
-            }
-            else
-            {
-                html << formatFileSize(info.st_size);
-            }
-            html << "</td>\n";
-
-            html << "        <td class=\"date\">" << formatTime(info.st_mtime) << "</td>\n";
-            html << "      </tr>\n";
-        }
-    }
-
-    html << "    </tbody>\n";
-    html << "  </table>\n";
-    html << "  <hr>\n";
-    html << "  <address>webserv/1.0 Server</address>\n";
-    html << "</body>\n";
-    html << "</html>\n";
-
-    return html.str();
-}
-
 std::string formatFileSize(size_t size)
 {
     std::ostringstream oss;
@@ -247,83 +137,33 @@ std::string formatTime(time_t timestamp)
     return std::string(buffer);
 }
 
-std::string getMimeType(const std::string &path)
+std::string formatHttpDate(time_t timestamp)
+{
+    char buffer[64];
+    struct tm timeinfo;
+
+    gmtime_r(&timestamp, &timeinfo);
+    strftime(buffer, sizeof(buffer), "%a, %d %b %Y %H:%M:%S GMT", &timeinfo);
+    return std::string(buffer);
+}
+
+/*
+** The extension of the last path segment, dot included (".php" for
+** "/a/b.php"), or an empty ref when that segment has no dot.
+*/
+StringRef pathExtension(const StringRef &path)
 {
-    size_t dot_pos = path.find_last_of('.');
+    size_t i = path.length;
 
-    if (dot_pos == std::string::npos)
+    while (i > 0 && path.data[i - 1] != '/')
     {
-        return "application/octet-stream";
+        i--;
+        if (path.data[i] == '.')
+        {
+            return StringRef(path.data + i, path.length - i);
+        }
     }
-
-    std::string ext = path.substr(dot_pos + 1);
-
-    std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
-
-    if (ext == "html" || ext == "htm")
-        return "text/html";
-    if (ext == "css")
-        return "text/css";
-    if (ext == "js")
-        return "application/javascript";
-    if (ext == "json")
-        return "application/json";
-    if (ext == "xml")
-        return "application/xml";
-    if (ext == "txt")
-        return "text/plain";
-    if (ext == "pdf")
-        return "application/pdf";
-
-    if (ext == "jpg" || ext == "jpeg")
-        return "image/jpeg";
-    if (ext == "png")
-        return "image/png";
-    if (ext == "gif")
-        return "image/gif";
-    if (ext == "svg")
-        return "image/svg+xml";
-    if (ext == "ico")
-        return "image/x-icon";
-    if (ext == "webp")
-        return "image/webp";
-
-    if (ext == "mp3")
-        return "audio/mpeg";
-    if (ext == "wav")
-        return "audio/wav";
-    if (ext == "mp4")
-        return "video/mp4";
-    if (ext == "webm")
-        return "video/webm";
-    if (ext == "ogg")
-        return "audio/ogg";
-    if (ext == "avi")
-        return "video/x-msvideo";
-
-    if (ext == "zip")
-        return "application/zip";
-    if (ext == "tar")
-        return "application/x-tar";
-    if (ext == "gz")
-        return "application/gzip";
-    if (ext == "rar")
-        return "application/x-rar-compressed";
-
-    if (ext == "doc")
-        return "application/msword";
-    if (ext == "docx")
-        return "application/vnd.openxmlformats-officedocument.wordprocessingml.document";
-    if (ext == "xls")
-        return "application/vnd.ms-excel";
-    if (ext == "xlsx")
-        return "application/vnd.openxmlformats-officedocument.spreadsheetml.sheet";
-    if (ext == "ppt")
-        return "application/vnd.ms-powerpoint";
-    if (ext == "pptx")
-        return "application/vnd.openxmlformats-officedocument.presentationml.presentation";
-
-    return "application/octet-stream";
+    return StringRef();
 }
 
 std::string urlDecode(const std::string &str)
@@ -444,3 +284,199 @@ std::string join(const std::vector<std::string> &strings, const std::string &del
 
     return result;
 }
+
+/*
+** MIME types whose payload is already compressed; running them through
+** deflate again only burns CPU.
+*/
+bool isCompressedMimeType(const std::string &mime)
+{
+    if (mime.compare(0, 6, "image/") == 0)
+        return mime != "image/svg+xml" && mime != "image/x-icon";
+    if (mime.compare(0, 6, "audio/") == 0 || mime.compare(0, 6, "video/") == 0)
+        return mime != "audio/wav";
+    if (mime.compare(0, 5, "font/") == 0)
+        return mime == "font/woff" || mime == "font/woff2";
+    return mime == "application/zip" || mime == "application/gzip"
+           || mime == "application/x-rar-compressed" || mime == "application/pdf"
+           || mime.compare(0, 46, "application/vnd.openxmlformats-officedocument.") == 0;
+}
+
+/*
+** Weight of one list element of an Accept-style header: the q= parameter
+** after its name, or 1 when there is none.
+*/
+static double qualityValue(const StringRef &header, size_t from, size_t end)
+{
+    for (size_t i = from; i + 1 < end; i++)
+    {
+        if ((header.data[i] == 'q' || header.data[i] == 'Q') && header.data[i + 1] == '=')
+        {
+            std::string qvalue(header.data + i + 2, end - i - 2);
+            return std::strtod(qvalue.c_str(), NULL);
+        }
+    }
+    return 1.0;
+}
+
+/*
+** Tells whether an Accept-Encoding value allows the given content coding.
+** An explicit entry wins over "*", and q=0 means "not acceptable".
+*/
+bool acceptsEncoding(const StringRef &header, const char *coding)
+{
+    bool star = false;
+    size_t pos = 0;
+
+    while (pos < header.length)
+    {
+        size_t end = pos;
+        while (end < header.length && header.data[end] != ',')
+            end++;
+
+        size_t name_start = pos;
+        while (name_start < end && (header.data[name_start] == ' ' || header.data[name_start] == '\t'))
+            name_start++;
+        size_t name_end = name_start;
+        while (name_end < end && header.data[name_end] != ';' && header.data[name_end] != ' '
+               && header.data[name_end] != '\t')
+            name_end++;
+
+        bool acceptable = qualityValue(header, name_end, end) > 0.0;
+        StringRef name(header.data + name_start, name_end - name_start);
+        if (name.equalsIgnoreCase(coding))
+            return acceptable;
+        if (name == "*")
+            star = acceptable;
+        pos = end + 1;
+    }
+    return star;
+}
+
+/*
+** Weight an Accept header gives to a media type such as "application/json".
+** The most specific matching range decides, whatever its q: the exact type,
+** then a "type/" wildcard, then the "any" range. A type no range matches gets
+** 0; a missing header accepts everything with weight 1.
+*/
+double mediaTypeQuality(const StringRef &header, const char *type)
+{
+    StringRef wanted(type);
+    size_t slash = 0;
+    int best = 0;
+    double quality = 0.0;
+    size_t pos = 0;
+
+    if (header.empty())
+        return 1.0;
+    while (slash < wanted.length && wanted.data[slash] != '/')
+        slash++;
+    while (pos < header.length)
+    {
+        size_t end = pos;
+        while (end < header.length && header.data[end] != ',')
+            end++;
+
+        size_t name_start = pos;
+        while (name_start < end && (header.data[name_start] == ' ' || header.data[name_start] == '\t'))
+            name_start++;
+        size_t name_end = name_start;
+        while (name_end < end && header.data[name_end] != ';' && header.data[name_end] != ' '
+               && header.data[name_end] != '\t')
+            name_end++;
+
+        StringRef range(header.data + name_start, name_end - name_start);
+        int specificity = 0;
+        if (range.equalsIgnoreCase(type))
+            specificity = 3;
+        else if (range.length == slash + 2 && range.data[slash + 1] == '*'
+                 && StringRef(range.data, slash + 1).equalsIgnoreCase(
+                        StringRef(wanted.data, slash + 1)))
+            specificity = 2;
+        else if (range == "*/*")
+            specificity = 1;
+        if (specificity > best)
+        {
+            best = specificity;
+            quality = qualityValue(header, name_end, end);
+        }
+        pos = end + 1;
+    }
+    return quality;
+}
+
+static bool parseOffset(const char *&ptr, const char *end, off_t &value)
+{
+    const char *start = ptr;
+
+    value = 0;
+    while (ptr < end && *ptr >= '0' && *ptr <= '9')
+    {
+        if (value > (static_cast<off_t>(1) << 58))
+            return false;
+        value = value * 10 + (*ptr - '0');
+        ptr++;
+    }
+    return ptr != start;
+}
+
+/*
+** Parses a "bytes=" Range header against a representation of the given size.
+** Unsatisfiable specs are dropped; if none is left the result is
+** RANGE_UNSATISFIABLE. A malformed header, or one with more than max_ranges
+** specs, is ignored (RANGE_NONE) and the full body is sent.
+*/
+RangeResult parseByteRanges(const StringRef &header, off_t size,
+                            std::vector<ByteRange> &ranges, size_t max_ranges)
+{
+    const char *ptr = header.data;
+    const char *end = header.data + header.length;
+    size_t specs = 0;
+
+    ranges.clear();
+    if (header.length < 6 || !StringRef(ptr, 6).equalsIgnoreCase("bytes="))
+        return RANGE_NONE;
+    ptr += 6;
+    while (ptr < end)
+    {
+        ByteRange range;
+        off_t first;
+        off_t last;
+        bool has_first;
+        bool has_last;
+
+        while (ptr < end && (*ptr == ' ' || *ptr == '\t'))
+            ptr++;
+        has_first = parseOffset(ptr, end, first);
+        if (ptr >= end || *ptr != '-')
+            return RANGE_NONE;
+        ptr++;
+        has_last = parseOffset(ptr, end, last);
+        while (ptr < end && (*ptr == ' ' || *ptr == '\t'))
+            ptr++;
+        if (ptr < end && *ptr++ != ',')
+            return RANGE_NONE;
+        if ((!has_first && !has_last) || (has_first && has_last && last < first))
+            return RANGE_NONE;
+        if (++specs > max_ranges)
+            return RANGE_NONE;
+        if (!has_first)
+        {
+            if (last == 0)
+                continue;
+            range.first = last < size ? size - last : 0;
+            range.last = size - 1;
+        }
+        else
+        {
+            if (first >= size)
+                continue;
+            range.first = first;
+            range.last = (!has_last || last >= size) ? size - 1 : last;
+        }
+        ranges.push_back(range);
+    }
+    if (specs == 0)
+        return RANGE_NONE;
+    return ranges.empty() ? RANGE_UNSATISFIABLE : RANGE_OK;
+}
@@ -0,0 +1,59 @@
+#!/bin/sh
+# Replacing a cached static file, by rename or in place, must serve the new
+# bytes at once even with open_file_cache_valid far in the future.
+# Usage: tests/static_cache_replace.sh [path/to/webserv]
+
+WEBSERV=${1:-./webserv}
+PORT=18931
+DIR=$(mktemp -d)
+URL=http://127.0.0.1:$PORT/style.css
+FAILS=0
+
+mkdir "$DIR/www"
+cat > "$DIR/test.conf" <<CONF
+open_file_cache max=100 inactive=60s
+open_file_cache_valid 60s
+static_cache max=1m max_entry=64k
+server {
+    listen $PORT
+    host 127.0.0.1
+    location / {
+        root $DIR/www
+        allow GET
+    }
+}
+CONF
+
+expect() {
+	BODY=$(curl -s "$URL")
+	if [ "$BODY" = "$1" ]; then
+		echo "ok   $2"
+	else
+		echo "FAIL $2: got '$BODY', expected '$1'"
+		FAILS=$((FAILS + 1))
+	fi
+}
+
+printf 'body{color:red}\n' > "$DIR/www/style.css"
+"$WEBSERV" "$DIR/test.conf" > "$DIR/log" 2>&1 &
+PID=$!
+sleep 0.5
+
+expect 'body{color:red}' "initial"
+expect 'body{color:red}' "cached"
+printf 'body{color:blue}\n' > "$DIR/www/new.css"
+mv "$DIR/www/new.css" "$DIR/www/style.css"
+sleep 0.2
+expect 'body{color:blue}' "rename over"
+printf 'a{}\n' >> "$DIR/www/style.css"
+sleep 0.2
+expect 'body{color:blue}
+a{}' "append in place"
+printf 'b{}\n' > "$DIR/www/style.css"
+sleep 0.2
+expect 'b{}' "truncate in place"
+
+kill $PID
+wait $PID 2>/dev/null
+rm -rf "$DIR"
+[ $FAILS -eq 0 ]